@@ -4,6 +4,7 @@ struct VertexInput {
   @location(2) coords: vec2f,
   @location(3) color: vec4f,
   @location(4) shapeType: u32,
+  @location(5) shapeDesc: u32,
 }
 
 struct VertexOutput {
@@ -12,6 +13,7 @@ struct VertexOutput {
   @location(1) coords: vec2f,
   @location(2) color: vec4f,
   @location(3) @interpolate(flat) shapeType: u32,
+  @location(4) @interpolate(flat) shapeDesc: u32,
 }
 
 @group(0) @binding(0) var<uniform> viewProj: mat4x4f;
@@ -24,7 +26,8 @@ fn vs_main(in: VertexInput) -> VertexOutput {
     in.size,
     in.coords,
     ToLinear(in.color),
-    in.shapeType
+    in.shapeType,
+    in.shapeDesc
   );
 
   return out;
@@ -41,6 +44,121 @@ fn ToLinear(color: vec4f) -> vec4f {
 
 const pi = radians(180.0);
 
+// box drawing ------------------------------------------------------------
+// descriptor encoding matches BoxDrawing::GpuDesc
+
+fn Bits(desc: u32, offset: u32, count: u32) -> u32 {
+  return (desc >> offset) & ((1u << count) - 1u);
+}
+
+// coverage of the pixel at p with footprint px by the rect [rmin, rmax]
+fn RectCoverage(p: vec2f, px: vec2f, rmin: vec2f, rmax: vec2f) -> f32 {
+  let lo = max(rmin, p - px * 0.5);
+  let hi = min(rmax, p + px * 0.5);
+  let cov = clamp((hi - lo) / px, vec2f(0), vec2f(1));
+  return cov.x * cov.y;
+}
+
+// same line widths as box::Pen
+fn LineWidth(weight: u32, size: vec2f) -> f32 {
+  switch weight {
+    case 1u { return size.x * 0.11; }
+    case 2u { return size.x * 0.22; }
+    case 3u { return size.x * 0.11 * 3; }
+    default { return 0; }
+  }
+}
+
+// line segment along the axis from start to end, centered at center on the other
+// axis. double weight is two light lines.
+fn LineCoverage(
+  p: vec2f, px: vec2f, size: vec2f,
+  weight: u32, vertical: bool, center: f32, start: f32, end: f32
+) -> f32 {
+  if (weight == 0u) {
+    return 0;
+  }
+  var offsets = array<f32, 2>(0, 0);
+  var width = LineWidth(weight, size);
+  if (weight == 3u) {
+    width = LineWidth(1u, size);
+    offsets = array<f32, 2>(-width, width);
+  }
+
+  var alpha: f32 = 0;
+  for (var i = 0; i < 2; i++) {
+    let c = center + offsets[i];
+    var rmin = vec2f(c - width / 2, start);
+    var rmax = vec2f(c + width / 2, end);
+    if (!vertical) {
+      rmin = rmin.yx;
+      rmax = rmax.yx;
+    }
+    alpha = max(alpha, RectCoverage(p, px, rmin, rmax));
+  }
+  return alpha;
+}
+
+fn BoxDrawing(p: vec2f, px: vec2f, size: vec2f, desc: u32) -> f32 {
+  let center = size / 2;
+  var alpha: f32 = 0;
+
+  switch Bits(desc, 0u, 4u) {
+    default {}
+    case 0u { // lines
+      let top = Bits(desc, 4u, 2u);
+      let bottom = Bits(desc, 6u, 2u);
+      let left = Bits(desc, 8u, 2u);
+      let right = Bits(desc, 10u, 2u);
+
+      // sides extend past the center to cover the joint
+      let vertWidth = max(LineWidth(top, size), LineWidth(bottom, size));
+      let horiWidth = max(LineWidth(left, size), LineWidth(right, size));
+
+      alpha = max(alpha, LineCoverage(
+        p, px, size, top, true, center.x, 0, center.y + horiWidth / 2
+      ));
+      alpha = max(alpha, LineCoverage(
+        p, px, size, bottom, true, center.x, center.y - horiWidth / 2, size.y
+      ));
+      alpha = max(alpha, LineCoverage(
+        p, px, size, left, false, center.y, 0, center.x + vertWidth / 2
+      ));
+      alpha = max(alpha, LineCoverage(
+        p, px, size, right, false, center.y, center.x - vertWidth / 2, size.x
+      ));
+    }
+    case 1u { // dash
+      let vertical = Bits(desc, 4u, 1u) == 1u;
+      let num = Bits(desc, 5u, 3u);
+      let weight = Bits(desc, 8u, 2u);
+      let len = select(size.x, size.y, vertical);
+      let c = select(center.y, center.x, vertical);
+
+      for (var i = 0u; i < num; i++) {
+        let start = (f32(i) + 0.15) / f32(num) * len;
+        let end = (f32(i) + 0.85) / f32(num) * len;
+        alpha = max(alpha, LineCoverage(p, px, size, weight, vertical, c, start, end));
+      }
+    }
+    case 2u { // rect in eighths
+      let rmin = vec2f(f32(Bits(desc, 4u, 4u)), f32(Bits(desc, 8u, 4u))) / 8 * size;
+      let rmax = vec2f(f32(Bits(desc, 12u, 4u)), f32(Bits(desc, 16u, 4u))) / 8 * size;
+      alpha = RectCoverage(p, px, rmin, rmax);
+    }
+    case 3u { // quadrant
+      for (var i = 0u; i < 4u; i++) {
+        if (Bits(desc, 4u + i, 1u) == 1u) {
+          let rmin = vec2f(f32(i % 2u), f32(i / 2u)) * center;
+          alpha = max(alpha, RectCoverage(p, px, rmin, rmin + center));
+        }
+      }
+    }
+  }
+
+  return alpha;
+}
+
 @fragment
 fn fs_main(in: VertexOutput) -> @location(0) vec4f {
   let x = in.coords.x;
@@ -49,6 +167,8 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
   let h = in.size.y;
   let xn = x / w;
   let yn = y / h;
+  // size of a physical pixel, must be computed in uniform control flow
+  let px = fwidth(in.coords);
 
   var alpha: f32 = 1;
 
@@ -83,12 +203,8 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
         alpha = 0;
       }
     }
-    case 5 { // braille circle
-      let radius = h * 0.5;
-      let fade = min(radius * 0.1, 1);
-
-      let dist = distance(in.coords, in.size / 2.);
-      alpha = 1 - smoothstep(radius - fade, radius, dist);
+    case 5 { // box drawing
+      alpha = BoxDrawing(in.coords, px, in.size, in.shapeDesc);
     }
   }
 
@@ -0,0 +1,64 @@
+struct VertexInput {
+  @location(0) position: vec2f,
+  @location(1) regionCoords: vec2f,
+  @location(2) foreground: vec4f,
+}
+
+struct VertexOutput {
+  @builtin(position) position: vec4f,
+  @location(0) uv: vec2f,
+  @location(1) opacity: f32,
+}
+
+@group(0) @binding(0) var<uniform> viewProj: mat4x4f;
+@group(1) @binding(0) var<uniform> gamma: f32;
+@group(2) @binding(0) var<uniform> textureSize : vec2f; // size of color atlas page
+
+@vertex
+fn vs_main(in: VertexInput) -> VertexOutput {
+  let uv = in.regionCoords / textureSize;
+  let out = VertexOutput(
+    viewProj * vec4f(in.position, 0.0, 1.0),
+    uv, in.foreground.a
+  );
+
+  return out;
+}
+
+struct FragmentInput {
+  @location(0) uv: vec2f,
+  @location(1) opacity: f32,
+}
+
+struct FragmentOutput {
+  @location(0) color: vec4f,
+}
+
+@group(3) @binding(0) var colorTexture : texture_2d<f32>;
+@group(3) @binding(1) var colorSampler : sampler;
+
+// bilinear sample, the sampler is non filtering.
+// filtering premultiplied colors doesn't bleed at transparent edges
+fn SampleColor(uv: vec2f) -> vec4f {
+  let dims = vec2i(textureDimensions(colorTexture));
+  let pos = uv * vec2f(dims) - 0.5;
+  let base = vec2i(floor(pos));
+  let t = fract(pos);
+
+  let maxPos = dims - 1;
+  let c00 = textureLoad(colorTexture, clamp(base, vec2i(0), maxPos), 0);
+  let c10 = textureLoad(colorTexture, clamp(base + vec2i(1, 0), vec2i(0), maxPos), 0);
+  let c01 = textureLoad(colorTexture, clamp(base + vec2i(0, 1), vec2i(0), maxPos), 0);
+  let c11 = textureLoad(colorTexture, clamp(base + vec2i(1, 1), vec2i(0), maxPos), 0);
+  return mix(mix(c00, c10, t.x), mix(c01, c11, t.x), t.y);
+}
+
+// texels are premultiplied srgb, the target is linear
+@fragment
+fn fs_main(in: FragmentInput) -> FragmentOutput {
+  let texel = SampleColor(in.uv);
+  let rgb = texel.rgb / max(texel.a, 1e-4);
+  let linear = pow(rgb, vec3f(gamma)) * texel.a;
+
+  return FragmentOutput(vec4f(linear, texel.a) * in.opacity);
+}
@@ -0,0 +1,83 @@
+// text pipeline of the sdf font mode, see text.wgsl for bitmap glyphs
+struct VertexInput {
+  @location(0) position: vec2f,
+  @location(1) regionCoords: vec2f,
+  @location(2) foreground: vec4f,
+}
+
+struct VertexOutput {
+  @builtin(position) position: vec4f,
+  @location(0) uv: vec2f,
+  @location(1) foreground: vec4f,
+}
+
+@group(0) @binding(0) var<uniform> viewProj: mat4x4f;
+@group(1) @binding(0) var<uniform> gamma: f32;
+@group(2) @binding(0) var<uniform> textureSize : vec2f; // size of texture atlas
+
+
+@vertex
+fn vs_main(in: VertexInput) -> VertexOutput {
+  let uv = in.regionCoords / textureSize;
+  let out = VertexOutput(
+    viewProj * vec4f(in.position, 0.0, 1.0),
+    uv, ToLinear(in.foreground)
+  );
+
+  return out;
+}
+
+fn ToLinear(color: vec4f) -> vec4f {
+  return vec4f(
+    pow(color.r, gamma),
+    pow(color.g, gamma),
+    pow(color.b, gamma),
+    color.a
+  );
+}
+
+struct FragmentInput {
+  @location(0) uv: vec2f,
+  @location(1) foreground: vec4f,
+}
+
+struct FragmentOutput {
+  @location(0) color: vec4f,
+}
+
+@group(3) @binding(0) var fontTexture : texture_2d<f32>;
+@group(3) @binding(1) var fontSampler : sampler;
+
+// bilinear sample of the distance in alpha, the sampler is non filtering
+fn SampleDistance(uv: vec2f) -> f32 {
+  let dims = vec2i(textureDimensions(fontTexture));
+  let pos = uv * vec2f(dims) - 0.5;
+  let base = vec2i(floor(pos));
+  let t = fract(pos);
+
+  let maxPos = dims - 1;
+  let d00 = textureLoad(fontTexture, clamp(base, vec2i(0), maxPos), 0).a;
+  let d10 = textureLoad(fontTexture, clamp(base + vec2i(1, 0), vec2i(0), maxPos), 0).a;
+  let d01 = textureLoad(fontTexture, clamp(base + vec2i(0, 1), vec2i(0), maxPos), 0).a;
+  let d11 = textureLoad(fontTexture, clamp(base + vec2i(1, 1), vec2i(0), maxPos), 0).a;
+  return mix(mix(d00, d10, t.x), mix(d01, d11, t.x), t.y);
+}
+
+@fragment
+fn fs_main(in: FragmentInput) -> FragmentOutput {
+  var out: FragmentOutput;
+
+  let texel = textureSample(fontTexture, fontSampler, in.uv);
+
+  // sdf glyphs are marked with rgb = 0, edge is at 128, inside is larger.
+  // coverage glyphs are used as is
+  let dist = SampleDistance(in.uv);
+  let fade = max(fwidth(dist) * 0.5, 1e-4);
+  let sdfAlpha = smoothstep(0.5 - fade, 0.5 + fade, dist);
+  let isSdf = texel.r < 0.5;
+
+  out.color = select(texel, vec4f(1, 1, 1, sdfAlpha), isSdf);
+  out.color = in.foreground * out.color;
+
+  return out;
+}
@@ -6,15 +6,26 @@ struct VertexInput {
 struct VertexOutput {
   @builtin(position) position: vec4f,
   @location(0) uv: vec2f,
+  @location(1) pos: vec2f,
+}
+
+// scroll offset and clip rect of the window, see ScrollUniform
+struct Scroll {
+  offset: vec2f,
+  clipMin: vec2f,
+  clipMax: vec2f,
 }
 
 @group(0) @binding(0) var<uniform> viewProj: mat4x4f;
+@group(4) @binding(0) var<uniform> scroll: Scroll;
 
 @vertex
 fn vs_main(in: VertexInput) -> VertexOutput {
+  let pos = in.position + scroll.offset;
   let out = VertexOutput(
-    viewProj * vec4f(in.position, 0.0, 1.0),
+    viewProj * vec4f(pos, 0.0, 1.0),
     in.uv,
+    pos,
   );
 
   return out;
@@ -28,8 +39,13 @@ fn vs_main(in: VertexInput) -> VertexOutput {
 
 
 @fragment
-fn fs_main(@location(0) uv: vec2f) -> @location(0) vec4f {
+fn fs_main(@location(0) uv: vec2f, @location(1) pos: vec2f) -> @location(0) vec4f {
+  // sample before discard, textureSample needs uniform control flow
   var color = textureSample(texture, textureSampler, uv);
+  if (any(pos < scroll.clipMin) || any(pos >= scroll.clipMax)) {
+    discard;
+  }
+
   if (color.a == 0.0f) {
     color = defaultColor;
   }
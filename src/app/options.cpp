@@ -61,6 +61,9 @@ std::future<Options> LoadOptions(Nvim& nvim) {
     LOAD(opacity),
 
     LOAD(gamma),
+    LOAD(gpuBoxDrawing),
+    LOAD(sdfFonts),
+    LOAD(texturePoolSize),
 
     LOAD(maxFps)
   );
@@ -29,6 +29,12 @@ struct Options {
   float opacity = 1;
 
   float gamma = 1.7;
+  // evaluate box drawing and block elements in a shader instead of the atlas
+  bool gpuBoxDrawing = false;
+  // render glyphs as distance fields, size changes don't re-rasterize
+  bool sdfFonts = false;
+  // MB of unused window textures kept for reuse, shared by all sessions
+  float texturePoolSize = 128;
 
   float maxFps = 60;
 };
@@ -2,9 +2,29 @@
 #include <CoreFoundation/CoreFoundation.h>
 #include <CoreServices/CoreServices.h>
 
+#include "SDL3/SDL_platform_defines.h"
 #include "utils/logger.hpp"
 #include <chrono>
 
+// per user cache dir of the platform, empty if it can't be determined
+static fs::path AppCacheDir() {
+#if defined(SDL_PLATFORM_MACOS)
+  if (const char* home = std::getenv("HOME")) {
+    return fs::path(home) / "Library" / "Caches" / "Neogurt";
+  }
+#else
+  // xdg spec says relative paths are invalid and should be ignored
+  if (const char* xdgCache = std::getenv("XDG_CACHE_HOME");
+      xdgCache && fs::path(xdgCache).is_absolute()) {
+    return fs::path(xdgCache) / "neogurt";
+  }
+  if (const char* home = std::getenv("HOME")) {
+    return fs::path(home) / ".cache" / "neogurt";
+  }
+#endif
+  return {};
+}
+
 void SetupPaths() {
   CFBundleRef mainBundle = CFBundleGetMainBundle();
   CFURLRef bundleUrl = CFBundleCopyBundleURL(mainBundle);
@@ -31,6 +51,9 @@ void SetupPaths() {
     resourcesDir = ROOT_DIR "/res";
   }
 
+  // cache dir
+  cacheDir = AppCacheDir().string();
+
   // logger stuff
   if (isAppBundle) {
     std::string homeDir = std::getenv("HOME");
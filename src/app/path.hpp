@@ -3,4 +3,6 @@
 
 inline std::string resourcesDir;
 inline bool isAppBundle;
+// persistent caches (glyphs, etc.), empty if unavailable
+inline std::string cacheDir;
 void SetupPaths();
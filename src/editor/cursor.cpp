@@ -135,7 +135,7 @@ void Cursor::Update(float dt) {
   }
 }
 
-bool Cursor::ShouldRender() {
+bool Cursor::ShouldRender() const {
   return cursorMode != nullptr && cursorMode->cursorShape != CursorShape::None &&
          blinkState != BlinkState::Off;
 }
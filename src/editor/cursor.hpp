@@ -70,5 +70,5 @@ struct Cursor {
   bool SetDestPos(glm::vec2 destPos);
   void SetMode(CursorMode* modeInfo);
   void Update(float dt);
-  bool ShouldRender();
+  bool ShouldRender() const;
 };
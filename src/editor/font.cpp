@@ -1,17 +1,136 @@
 #include "font.hpp"
+#include "gfx/font/locator.hpp"
 #include "gfx/instance.hpp"
+#include "utils/logger.hpp"
+#include "utils/timer.hpp"
+#include "utils/unicode.hpp"
 #include "webgpu_tools/utils/webgpu.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <ranges>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <boost/lexical_cast.hpp>
 
+using namespace std::chrono;
+
 static auto SplitStr(std::string_view str, char delim) {
   return std::views::split(str, delim) |
          std::views::transform([](auto&& r) { return std::string_view(r); });
 }
 
-std::expected<FontFamily, std::string>
-FontFamily::FromGuifont(std::string guifont, float linespace, float dpiScale) {
+LazyFont::LazyFont(FontDescriptorWithName _desc, float _linespace, float _dpiScale)
+    : desc(std::move(_desc)), linespace(_linespace), dpiScale(_dpiScale) {
+  path = std::async(std::launch::async, [desc = desc] {
+    return GetFontPathFromName(desc);
+  }).share();
+}
+
+LazyFont LazyFont::WithSize(float height, float width, float _dpiScale) const {
+  LazyFont lazyFont;
+  lazyFont.desc = desc;
+  lazyFont.desc.height = height;
+  lazyFont.desc.width = width;
+  lazyFont.linespace = linespace;
+  lazyFont.dpiScale = _dpiScale;
+  lazyFont.path = path;
+  lazyFont.failed = failed;
+  lazyFont.sdf = sdf;
+  return lazyFont;
+}
+
+std::string LazyFont::Id() const {
+  if (Empty()) return "";
+  return desc.name + (desc.bold ? ":b" : "") + (desc.italic ? ":i" : "");
+}
+
+std::string LazyFont::ResolvedId() const {
+  if (Empty()) return "";
+  const auto& fontPath = path.get();
+  return fontPath.empty() ? Id() : fontPath;
+}
+
+Font* LazyFont::Get() {
+  if (font) return font.get();
+  if (failed || Empty()) return nullptr;
+
+  const auto& fontPath = path.get();
+  if (fontPath.empty()) {
+    LOG_WARN("Failed to find font for: {}", Id());
+    failed = true;
+    return nullptr;
+  }
+
+  try {
+    font = std::make_shared<Font>(
+      fontPath, desc.height, desc.width, linespace, dpiScale, sdf
+    );
+  } catch (const std::runtime_error& e) {
+    LOG_WARN("{}", e.what());
+    failed = true;
+  }
+  return font.get();
+}
+
+Font* FontSet::Get(bool isBold, bool isItalic) {
+  auto& variant = [&]() -> LazyFont& {
+    if (isBold && isItalic) return boldItalic;
+    if (isBold) return bold;
+    if (isItalic) return italic;
+    return normal;
+  }();
+
+  // share the normal face if the variant resolves to the same file
+  if (&variant != &normal && !variant.Empty() && !variant.font && !variant.failed &&
+      variant.path.get() == normal.path.get() && normal.Get()) {
+    variant.font = normal.font;
+  }
+
+  if (auto* font = variant.Get()) {
+    return font;
+  }
+  return normal.Get();
+}
+
+static const GlyphInfo& GetGlyphInfo(
+  std::vector<FontSet>& fonts,
+  BoxDrawing& boxDrawing,
+  TextureAtlas& textureAtlas,
+  char32_t charcode,
+  bool bold,
+  bool italic,
+  int subpixel = 0
+) {
+  if (BoxDrawing::Contains(charcode)) {
+    if (const auto *glyphInfo = boxDrawing.GetGlyphInfo(charcode, textureAtlas)) {
+      return *glyphInfo;
+    }
+  }
+
+  for (auto& fontSet : fonts) {
+    auto* font = fontSet.Get(bold, italic);
+    if (font == nullptr) continue;
+
+    if (const auto* glyphInfo = font->GetGlyphInfo(charcode, textureAtlas, subpixel)) {
+      return *glyphInfo;
+    }
+  }
+
+  for (auto& fontSet : fonts) {
+    auto* font = fontSet.normal.Get();
+    if (font == nullptr) continue;
+
+    if (const auto* glyphInfo = font->GetGlyphInfo(' ', textureAtlas)) {
+      return *glyphInfo;
+    }
+  }
+  throw std::runtime_error("Failed to get glyph for space character");
+}
+
+std::expected<FontFamily::Guifont, std::string>
+FontFamily::ParseGuifont(std::string guifont, float linespace, float dpiScale) {
   if (guifont.empty()) {
     return std::unexpected("Empty guifont");
   }
@@ -46,173 +165,558 @@ FontFamily::FromGuifont(std::string guifont, float linespace, float dpiScale) {
     }
   }
 
-  try {
-    FontFamily fontFamily{
-      .fonts = SplitStr(fontsStr, ',') | std::views::transform([&](auto&& fontName) {
-        FontSet fontSet;
-        auto makeFontHandle = [&](bool bold, bool italic) {
-          auto font = Font::FromName(
-            {
-              .name = std::string(fontName),
-              .height = height,
-              .width = width,
-              .bold = bold,
-              .italic = italic,
-            },
-            linespace,
-            dpiScale
-          )
-          .value(); // allow exception to propagate
-
-          // reuse the existing FontHandle
-          if (fontSet.normal && font.path == fontSet.normal->path) {
-            return fontSet.normal;
-          }
-          // otherwise, create a new FontHandle
-          return std::make_shared<Font>(std::move(font));
-        };
-
-        fontSet.normal = makeFontHandle(bold, italic);
-
-        if (!(bold || italic)) {
-          fontSet.bold = makeFontHandle(true, false);
-          fontSet.italic = makeFontHandle(false, true);
-          fontSet.boldItalic = makeFontHandle(true, true);
-        }
+  // variants and fallbacks are opened on first use. all path lookups run in
+  // parallel on worker threads.
+  auto fonts =
+    SplitStr(fontsStr, ',') | std::views::transform([&](auto&& fontName) {
+      auto makeLazyFont = [&](bool bold, bool italic) {
+        return LazyFont(
+          {
+            .name = std::string(fontName),
+            .height = height,
+            .width = width,
+            .bold = bold,
+            .italic = italic,
+          },
+          linespace, dpiScale
+        );
+      };
 
-        return fontSet;
-      }) |
-      std::ranges::to<std::vector>(),
-      .boxDrawing{fontFamily.DefaultFont().charSize, dpiScale},
-      .textureAtlas{height, dpiScale},
-      .defaultHeight = height,
-      .defaultWidth = width,
-    };
-    return fontFamily;
+      FontSet fontSet{.normal = makeLazyFont(bold, italic)};
+      if (!(bold || italic)) {
+        fontSet.bold = makeLazyFont(true, false);
+        fontSet.italic = makeLazyFont(false, true);
+        fontSet.boldItalic = makeLazyFont(true, true);
+      }
+      return fontSet;
+    }) |
+    std::ranges::to<std::vector>();
 
-  } catch (const std::bad_expected_access<std::string>& e) {
-    return std::unexpected(e.error());
+  if (fonts.empty()) {
+    return std::unexpected("Empty guifont");
   }
+  return Guifont{
+    .fonts = std::move(fonts),
+    .height = height,
+    .width = width,
+  };
 }
 
-void FontFamily::ChangeDpiScale(float dpiScale) {
-  std::vector<FontSet> newFonts;
-  for (auto& fontSet : fonts) {
-    FontSet& newFontSet = newFonts.emplace_back();
-    auto makeFontHandle = [&](const FontHandle& fontHandle) -> FontHandle {
-      // check if the normal font can be reused
-      if (newFontSet.normal && fontHandle->path == newFontSet.normal->path) {
-        return newFontSet.normal;
-      }
-      return std::make_shared<Font>(
-        fontHandle->path, fontHandle->height, fontHandle->width, fontHandle->linespace,
-        dpiScale
-      );
+// faces opened so far, a face shared by several styles is counted once
+static size_t OpenedFaces(const std::vector<FontSet>& fonts) {
+  std::unordered_set<const Font*> opened;
+  for (const auto& fontSet : fonts) {
+    for (const auto* lazyFont :
+         {&fontSet.normal, &fontSet.bold, &fontSet.italic, &fontSet.boldItalic}) {
+      if (lazyFont->font) opened.insert(lazyFont->font.get());
+    }
+  }
+  return opened.size();
+}
+
+std::expected<FontFamily, std::string> FontFamily::FromGuifont(
+  Guifont guifont, float dpiScale, bool sdf, bool gpuBoxDrawing
+) {
+  auto startTime = Time();
+
+  // only the primary font is opened here
+  if (guifont.fonts.front().normal.Get() == nullptr) {
+    return std::unexpected(
+      "Failed to find font for: " + guifont.fonts.front().normal.desc.name
+    );
+  }
+
+  FontFamily fontFamily{
+    .fonts = std::move(guifont.fonts),
+    .defaultHeight = guifont.height,
+    .defaultWidth = guifont.width,
+    .gpuBoxDrawing = gpuBoxDrawing,
+    .sdf = sdf,
+  };
+  fontFamily.boxDrawing = BoxDrawing(fontFamily.DefaultFont().charSize, dpiScale);
+  if (sdf) {
+    fontFamily.InitSdf();
+    fontFamily.boxAtlas = TextureAtlas(guifont.height, dpiScale);
+  } else {
+    fontFamily.textureAtlas = TextureAtlas(guifont.height, dpiScale);
+    fontFamily.PrerenderBoxDrawing();
+  }
+
+  auto duration = duration_cast<microseconds>(Time() - startTime);
+  LOG_INFO(
+    "FontFamily::FromGuifont: {} fonts, {} faces opened in {}",
+    fontFamily.fonts.size(), OpenedFaces(fontFamily.fonts), duration
+  );
+
+  return fontFamily;
+}
+
+std::expected<FontFamily, std::string> FontFamily::FromGuifont(
+  std::string guifont, float linespace, float dpiScale, bool sdf, bool gpuBoxDrawing
+) {
+  auto parsed = ParseGuifont(std::move(guifont), linespace, dpiScale);
+  if (!parsed) {
+    return std::unexpected(parsed.error());
+  }
+  return FromGuifont(std::move(*parsed), dpiScale, sdf, gpuBoxDrawing);
+}
+
+// creates fonts for size with the same path lookups as fonts
+static std::vector<FontSet> MakeFonts(
+  const std::vector<FontSet>& fonts, const FontFamily::Size& size, bool sdf = false
+) {
+  auto newFonts = fonts | std::views::transform([&](const FontSet& fontSet) {
+    auto withSize = [&](const LazyFont& lazyFont) {
+      auto newFont = lazyFont.WithSize(size.height, size.width, size.dpiScale);
+      newFont.sdf = sdf;
+      return newFont;
+    };
+    return FontSet{
+      .normal = withSize(fontSet.normal),
+      .bold = withSize(fontSet.bold),
+      .italic = withSize(fontSet.italic),
+      .boldItalic = withSize(fontSet.boldItalic),
     };
+  }) |
+  std::ranges::to<std::vector>();
 
-    newFontSet.normal = makeFontHandle(fontSet.normal);
-    newFontSet.bold = makeFontHandle(fontSet.bold);
-    newFontSet.italic = makeFontHandle(fontSet.italic);
-    newFontSet.boldItalic = makeFontHandle(fontSet.boldItalic);
+  // metrics of the primary font are needed right away
+  if (newFonts.front().normal.Get() == nullptr) {
+    throw std::runtime_error("Failed to open font: " + newFonts.front().normal.Id());
   }
-  fonts = std::move(newFonts);
-  boxDrawing = BoxDrawing(DefaultFont().charSize, dpiScale);
-  textureAtlas = TextureAtlas(DefaultFont().height, dpiScale);
+  return newFonts;
 }
 
-void FontFamily::ChangeSize(float delta) {
-  std::vector<FontSet> newFonts;
-  for (auto& fontSet : fonts) {
-    FontSet& newFontSet = newFonts.emplace_back();
+FontFamily::Size FontFamily::CurrentSize() const {
+  const auto& defaultFont = DefaultFont();
+  return {defaultFont.height, defaultFont.width, defaultFont.dpiScale};
+}
 
-    auto makeFontHandle = [&](const FontHandle& fontHandle) -> FontHandle {
-      // check if the normal font can be reused
-      if (newFontSet.normal && fontHandle->path == newFontSet.normal->path) {
-        return newFontSet.normal;
-      }
+FontFamily::Size FontFamily::DeltaSize(float delta) const {
+  float newHeight = DefaultFont().height + delta;
+  newHeight = std::max(4.0f, newHeight);
 
-      float newHeight = fontHandle->height + delta;
-      newHeight = std::max(4.0f, newHeight);
+  float widthHeightRatio = defaultWidth / defaultHeight;
+  float newWidth = newHeight * widthHeightRatio;
 
-      float widthHeightRatio = defaultWidth / defaultHeight;
-      float newWidth = newHeight * widthHeightRatio;
+  return {newHeight, newWidth, DefaultFont().dpiScale};
+}
 
-      return std::make_shared<Font>(
-        fontHandle->path, newHeight, newWidth, fontHandle->linespace,
-        fontHandle->dpiScale
-      );
-    };
+FontFamily::Size FontFamily::DefaultSize() const {
+  return {defaultHeight, defaultWidth, DefaultFont().dpiScale};
+}
 
-    newFontSet.normal = makeFontHandle(fontSet.normal);
-    newFontSet.bold = makeFontHandle(fontSet.bold);
-    newFontSet.italic = makeFontHandle(fontSet.italic);
-    newFontSet.boldItalic = makeFontHandle(fontSet.boldItalic);
+FontFamily::Key FontFamily::MakeKey(
+  const std::vector<FontSet>& fonts, const Size& size, bool sdf, bool gpuBoxDrawing
+) {
+  Key key{
+    // only waits for the primary lookup, which is opened on a miss anyway
+    .primaryPath = fonts.front().normal.ResolvedId(),
+    .fonts = {},
+    // same rounding as Font
+    .trueHeight = int(size.height * size.dpiScale),
+    .trueWidth = int(size.width * size.dpiScale),
+    .trueLinespace = int(fonts.front().normal.linespace * size.dpiScale),
+    .dpiScale = size.dpiScale,
+    .sdf = sdf,
+    .gpuBoxDrawing = gpuBoxDrawing,
+  };
+  for (const auto& fontSet : fonts | std::views::drop(1)) {
+    key.fonts.push_back(fontSet.normal.Id());
   }
-  fonts = std::move(newFonts);
-  boxDrawing = BoxDrawing(DefaultFont().charSize, boxDrawing.dpiScale);
-  textureAtlas = TextureAtlas(DefaultFont().height, textureAtlas.dpiScale);
+  return key;
 }
 
-void FontFamily::ResetSize() {
-  std::vector<FontSet> newFonts;
-  for (auto& fontSet : fonts) {
-    FontSet& newFontSet = newFonts.emplace_back();
-    auto makeFontHandle = [&](const FontHandle& fontHandle) -> FontHandle {
-      // check if the normal font can be reused
-      if (newFontSet.normal && fontHandle->path == newFontSet.normal->path) {
-        return newFontSet.normal;
+FontFamily::Key FontFamily::GetKey(const Size& size) const {
+  return MakeKey(fonts, size, sdf, gpuBoxDrawing);
+}
+
+void FontFamily::SetSize(const Size& size) {
+  int trueHeight = size.height * size.dpiScale;
+  const auto& defaultFont = DefaultFont();
+  FontSizeState prevState{
+    .trueHeight = int(std::round(defaultFont.height * defaultFont.dpiScale)),
+    .dpiScale = defaultFont.dpiScale,
+  };
+  if (prevState.trueHeight == trueHeight && prevState.dpiScale == size.dpiScale) {
+    return;
+  }
+
+  shapedRuns.clear();
+  shapedRunMap.clear();
+
+  auto startTime = Time();
+  auto LogDuration = [&] {
+    auto duration = duration_cast<microseconds>(Time() - startTime);
+    LOG_INFO(
+      "FontFamily::SetSize: {}px at {}x ({}) in {}", trueHeight, size.dpiScale,
+      sdf ? "sdf" : "bitmap", duration
+    );
+  };
+
+  if (sdf) {
+    // only metrics and box drawing depend on the size
+    fonts = MakeFonts(fonts, size);
+    sdfGlyphInfos.clear();
+
+    auto charSize = DefaultFont().charSize;
+    auto boxIt = std::ranges::find_if(sdfBoxCache, [&](const SdfBoxPage& page) {
+      return page.boxDrawing.size == charSize &&
+             page.boxDrawing.dpiScale == size.dpiScale;
+    });
+    SdfBoxPage page;
+    if (boxIt != sdfBoxCache.end()) {
+      page = std::move(*boxIt);
+      sdfBoxCache.erase(boxIt);
+    } else {
+      page.boxDrawing = BoxDrawing(charSize, size.dpiScale);
+      page.atlas = TextureAtlas(DefaultFont().height, size.dpiScale);
+    }
+    sdfBoxCache.push_front({
+      std::exchange(boxDrawing, std::move(page.boxDrawing)),
+      std::exchange(boxAtlas, std::move(page.atlas)),
+    });
+    if (sdfBoxCache.size() > maxCachedSizes) {
+      sdfBoxCache.pop_back();
+    }
+    LogDuration();
+    return;
+  }
+
+  auto cachedIt = std::ranges::find_if(sizeCache, [&](const FontSizeState& state) {
+    return state.trueHeight == trueHeight && state.dpiScale == size.dpiScale;
+  });
+
+  if (cachedIt != sizeCache.end()) {
+    if (cachedIt->prewarm.valid()) cachedIt->prewarm.wait();
+    prevState.fonts = std::exchange(fonts, std::move(cachedIt->fonts));
+    prevState.boxDrawing = std::exchange(boxDrawing, std::move(cachedIt->boxDrawing));
+    prevState.textureAtlas =
+      std::exchange(textureAtlas, std::move(cachedIt->textureAtlas));
+    sizeCache.erase(cachedIt);
+
+  } else {
+    prevState.fonts = std::exchange(fonts, MakeFonts(fonts, size));
+    prevState.boxDrawing =
+      std::exchange(boxDrawing, BoxDrawing(DefaultFont().charSize, size.dpiScale));
+    prevState.textureAtlas =
+      std::exchange(textureAtlas, TextureAtlas(DefaultFont().height, size.dpiScale));
+    PrerenderBoxDrawing();
+  }
+
+  sizeCache.push_front(std::move(prevState));
+  if (sizeCache.size() > maxCachedSizes) {
+    sizeCache.pop_back();
+  }
+  LogDuration();
+}
+
+FontFamily FontFamily::WithSize(const Size& size) const {
+  FontFamily fontFamily{
+    .fonts = MakeFonts(fonts, size),
+    .defaultHeight = defaultHeight,
+    .defaultWidth = defaultWidth,
+    .gpuBoxDrawing = gpuBoxDrawing,
+    .sdf = sdf,
+  };
+  fontFamily.boxDrawing = BoxDrawing(fontFamily.DefaultFont().charSize, size.dpiScale);
+  if (sdf) {
+    fontFamily.InitSdf();
+    fontFamily.boxAtlas =
+      TextureAtlas(fontFamily.DefaultFont().height, size.dpiScale);
+  } else {
+    fontFamily.textureAtlas =
+      TextureAtlas(fontFamily.DefaultFont().height, size.dpiScale);
+    fontFamily.PrerenderBoxDrawing();
+  }
+  return fontFamily;
+}
+
+void FontFamily::InitSdf() {
+  const auto& defaultFont = DefaultFont();
+  float scale = sdfHeight / defaultFont.height;
+  // rendered at dpi scale 1, so sizes are in pixels
+  sdfFonts = MakeFonts(
+    fonts, {.height = sdfHeight, .width = defaultFont.width * scale, .dpiScale = 1},
+    true
+  );
+  textureAtlas = TextureAtlas(sdfHeight, 1);
+  sdfGlyphInfos.clear();
+  shapedRuns.clear();
+  shapedRunMap.clear();
+}
+
+void FontFamily::PrerenderBoxDrawing() {
+  boxDrawing.Prerender(textureAtlas, [this](char32_t charcode) {
+    return !GpuBoxDesc(charcode).has_value();
+  });
+}
+
+void FontFamily::Prewarm(std::vector<GlyphKey> glyphs) {
+  auto startTime = Time();
+
+  // regular only, styled faces are opened lazily and visible glyphs already
+  // cover the styles in use
+  for (char32_t charcode = '!'; charcode <= '~'; charcode++) {
+    glyphs.push_back({charcode, false, false});
+  }
+  std::ranges::sort(glyphs);
+  auto [first, last] = std::ranges::unique(glyphs);
+  glyphs.erase(first, last);
+  std::erase_if(glyphs, [this](const GlyphKey& glyph) {
+    return GpuBoxDesc(glyph.charcode).has_value();
+  });
+
+  // resolve fonts here, opening fonts isn't thread safe. a font may be shared by
+  // several styles, so work is split by font and not by style.
+  auto& glyphFonts = sdf ? sdfFonts : fonts;
+  std::unordered_map<Font*, std::vector<char32_t>> fontCharcodes;
+  for (const auto& [charcode, bold, italic] : glyphs) {
+    if (BoxDrawing::Contains(charcode)) continue;
+    for (auto& fontSet : glyphFonts) {
+      auto* font = fontSet.Get(bold, italic);
+      if (font && FT_Get_Char_Index(font->face.get(), charcode) != 0) {
+        fontCharcodes[font].push_back(charcode);
+        break;
       }
-      return std::make_shared<Font>(
-        fontHandle->path, defaultHeight, defaultWidth, fontHandle->linespace,
-        fontHandle->dpiScale
-      );
-    };
+    }
+  }
+
+  // variants are only needed if cells don't start on whole pixels
+  std::vector<int> subpixels{0};
+  if (!sdf && DefaultFont().fractionalWidth) {
+    subpixels = std::views::iota(0, Font::subpixelBuckets) |
+                std::ranges::to<std::vector>();
+  }
+
+  std::vector<std::future<void>> tasks;
+  for (auto& [font, charcodes] : fontCharcodes) {
+    tasks.push_back(std::async(std::launch::async, [&, font] {
+      font->Rasterize(charcodes, subpixels);
+    }));
+  }
+  for (auto& task : tasks) task.wait();
+
+  // sequential, the atlas isn't thread safe. cheap since everything is rasterized.
+  for (const auto& [charcode, bold, italic] : glyphs) {
+    for (int subpixel : subpixels) {
+      GetGlyphInfo(charcode, bold, italic, subpixel);
+    }
+  }
+  textureAtlas.Update();
+  if (sdf) boxAtlas.Update();
+
+  auto duration = duration_cast<microseconds>(Time() - startTime);
+  LOG_INFO(
+    "FontFamily::Prewarm: {} glyphs, {} fonts in {}", glyphs.size(),
+    fontCharcodes.size(), duration
+  );
+}
 
-    newFontSet.normal = makeFontHandle(fontSet.normal);
-    newFontSet.bold = makeFontHandle(fontSet.bold);
-    newFontSet.italic = makeFontHandle(fontSet.italic);
-    newFontSet.boldItalic = makeFontHandle(fontSet.boldItalic);
+void FontFamily::PrewarmCachedSizes(std::vector<GlyphKey> glyphs) {
+  std::erase_if(glyphs, [this](const GlyphKey& glyph) {
+    return GpuBoxDesc(glyph.charcode).has_value();
+  });
+  if (glyphs.empty()) return;
+  auto sharedGlyphs = std::make_shared<const std::vector<GlyphKey>>(std::move(glyphs));
+
+  for (auto& state : sizeCache) {
+    // list nodes are stable, and the state waits for the task before it is used
+    // or destroyed, so capturing by reference is fine
+    state.prewarm = std::async(
+      std::launch::async,
+      [&state, sharedGlyphs, prev = std::move(state.prewarm)]() mutable {
+        if (prev.valid()) prev.wait();
+        for (const auto& [charcode, bold, italic] : *sharedGlyphs) {
+          ::GetGlyphInfo(
+            state.fonts, state.boxDrawing, state.textureAtlas, charcode, bold, italic
+          );
+        }
+      }
+    );
   }
-  fonts = std::move(newFonts);
-  boxDrawing = BoxDrawing(DefaultFont().charSize, boxDrawing.dpiScale);
-  textureAtlas = TextureAtlas(DefaultFont().height, textureAtlas.dpiScale);
 }
 
 const Font& FontFamily::DefaultFont() const {
-  return *fonts.front().normal;
+  // always opened by FromGuifont and size changes
+  return *fonts.front().normal.font;
+}
+
+std::optional<uint32_t> FontFamily::GpuBoxDesc(char32_t charcode) const {
+  if (!gpuBoxDrawing) return std::nullopt;
+  return BoxDrawing::GpuDesc(charcode);
+}
+
+bool FontFamily::InBoxAtlas(char32_t charcode) const {
+  return sdf && BoxDrawing::Contains(charcode);
 }
 
 const GlyphInfo&
-FontFamily::GetGlyphInfo(char32_t charcode, bool bold, bool italic) {
-  if (charcode >= 0x2500 && charcode <= 0x259F) {
-    if (const auto *glyphInfo = boxDrawing.GetGlyphInfo(charcode, textureAtlas)) {
-      return *glyphInfo;
-    }
+FontFamily::GetGlyphInfo(char32_t charcode, bool bold, bool italic, int subpixel) {
+  if (!sdf || BoxDrawing::Contains(charcode)) {
+    return ::GetGlyphInfo(
+      fonts, boxDrawing, sdf ? boxAtlas : textureAtlas, charcode, bold, italic,
+      subpixel
+    );
   }
 
-  for (const auto& fontSet : fonts) {
-    const auto& font = [&] {
-      if (bold && italic) {
-        return fontSet.boldItalic ? fontSet.boldItalic : fontSet.normal;
-      }
-      if (bold) {
-        return fontSet.bold ? fontSet.bold : fontSet.normal;
+  GlyphKey key{charcode, bold, italic};
+  if (auto it = sdfGlyphInfos.find(key); it != sdfGlyphInfos.end()) {
+    return it->second;
+  }
+
+  auto glyphInfo =
+    ::GetGlyphInfo(sdfFonts, boxDrawing, textureAtlas, charcode, bold, italic);
+  // sdfFonts positions are in pixels at sdfHeight
+  float scale = DefaultFont().height / sdfHeight;
+  for (auto& pos : glyphInfo.localPoss) {
+    pos *= scale;
+  }
+  return sdfGlyphInfos.emplace(key, glyphInfo).first->second;
+}
+
+// zero width format chars with no glyph of their own
+static bool IsIgnorable(char32_t charcode) {
+  return (charcode >= 0x200B && charcode <= 0x200F) || // zero width space, joiners
+         (charcode >= 0xFE00 && charcode <= 0xFE0F) || // variation selectors
+         (charcode >= 0xE0100 && charcode <= 0xE01EF);
+}
+
+const ShapedRun& FontFamily::ShapeRun(
+  const std::string& cellTexts, bool bold, bool italic, int startSubpixel
+) {
+  std::string key = cellTexts;
+  key += char(bold);
+  key += char(italic);
+  key += char(startSubpixel);
+
+  if (auto it = shapedRunMap.find(key); it != shapedRunMap.end()) {
+    shapedRuns.splice(shapedRuns.begin(), shapedRuns, it->second);
+    return it->second->second;
+  }
+
+  ShapedRun run;
+  float charWidth = DefaultFont().charSize.x;
+  float dpiScale = DefaultFont().dpiScale;
+  bool fractionalWidth = DefaultFont().fractionalWidth;
+  constexpr int buckets = Font::subpixelBuckets;
+  size_t start = 0;
+  for (int cellIndex = 0; start < cellTexts.size(); cellIndex++) {
+    size_t end = cellTexts.find('\0', start);
+    if (end == std::string::npos) end = cellTexts.size();
+    auto text = std::string_view(cellTexts).substr(start, end - start);
+    start = end + 1;
+
+    float cellX = cellIndex * charWidth;
+    auto charcodes = UTF8ToChar32String(text);
+    for (size_t i = 0; i < charcodes.size(); i++) {
+      char32_t charcode = charcodes[i];
+      if (i == 0 && charcode == ' ') continue;
+      if (i > 0 && !IsCombiningMark(charcode)) continue;
+      if (IsIgnorable(charcode)) continue;
+
+      // shapes are resolution independent, placed on the unsnapped cell
+      if (auto gpuDesc = GpuBoxDesc(charcode)) {
+        run.push_back({charcode, nullptr, {cellX, 0}, cellIndex, gpuDesc});
+        continue;
       }
-      if (italic) {
-        return fontSet.italic ? fontSet.italic : fontSet.normal;
+
+      float x = cellX;
+      if (i > 0) {
+        // no mark positioning without shaping, center it over the cell
+        const auto& poss = GetGlyphInfo(charcode, bold, italic).localPoss;
+        x += (charWidth - (poss[1].x - poss[0].x)) / 2 - poss[0].x;
       }
-      return fontSet.normal;
-    }();
 
-    if (const auto* glyphInfo = font->GetGlyphInfo(charcode, textureAtlas)) {
-      return *glyphInfo;
+      // snap to the pixel and pick the variant rasterized at the remainder.
+      // whole pixel cells only need float error rounded off
+      float pixelX = float(startSubpixel) / buckets + x * dpiScale;
+      float snappedX = fractionalWidth ? std::floor(pixelX) : std::round(pixelX);
+      int subpixel =
+        fractionalWidth ? std::min(int((pixelX - snappedX) * buckets), buckets - 1)
+                        : 0;
+
+      const auto& glyphInfo = GetGlyphInfo(charcode, bold, italic, subpixel);
+      glm::vec2 offset(snappedX / dpiScale, 0);
+      run.push_back({charcode, &glyphInfo, offset, cellIndex, std::nullopt});
     }
   }
 
-  for (const auto& fontSet : fonts) {
-    if (const auto* glyphInfo = fontSet.normal->GetGlyphInfo(' ', textureAtlas)) {
-      return *glyphInfo;
-    }
+  shapedRuns.emplace_front(key, std::move(run));
+  shapedRunMap[std::move(key)] = shapedRuns.begin();
+  if (shapedRuns.size() > maxShapedRuns) {
+    shapedRunMap.erase(shapedRuns.back().first);
+    shapedRuns.pop_back();
   }
-  throw std::runtime_error("Failed to get glyph for space character");
+  return shapedRuns.front().second;
+}
+
+// ------------------------------------------------------------------
+std::expected<FontFamilyHandle, std::string> FontFamilyRegistry::FromGuifont(
+  std::string guifont, float linespace, float dpiScale, bool sdf, bool gpuBoxDrawing
+) {
+  auto parsed = FontFamily::ParseGuifont(std::move(guifont), linespace, dpiScale);
+  if (!parsed) {
+    return std::unexpected(parsed.error());
+  }
+
+  std::erase_if(families, [](const auto& pair) { return pair.second.expired(); });
+
+  // the key only needs the primary path lookup, the family is built on a miss
+  FontFamily::Size size{parsed->height, parsed->width, dpiScale};
+  auto key = FontFamily::MakeKey(parsed->fonts, size, sdf, gpuBoxDrawing);
+  auto& entry = families[key];
+  if (auto existing = entry.lock()) {
+    return existing;
+  }
+
+  auto fontFamily =
+    FontFamily::FromGuifont(std::move(*parsed), dpiScale, sdf, gpuBoxDrawing);
+  if (!fontFamily) {
+    families.erase(key);
+    return std::unexpected(fontFamily.error());
+  }
+  auto handle = std::make_shared<FontFamily>(std::move(*fontFamily));
+  entry = handle;
+  return handle;
+}
+
+void FontFamilyRegistry::ChangeDpiScale(FontFamilyHandle& handle, float dpiScale) {
+  auto size = handle->CurrentSize();
+  size.dpiScale = dpiScale;
+  SetSize(handle, size);
+}
+
+void FontFamilyRegistry::ChangeSize(FontFamilyHandle& handle, float delta) {
+  SetSize(handle, handle->DeltaSize(delta));
+}
+
+void FontFamilyRegistry::ResetSize(FontFamilyHandle& handle) {
+  SetSize(handle, handle->DefaultSize());
+}
+
+void FontFamilyRegistry::SetSize(
+  FontFamilyHandle& handle, const FontFamily::Size& size
+) {
+  std::erase_if(families, [](const auto& pair) { return pair.second.expired(); });
+
+  auto key = handle->GetKey(size);
+  auto& entry = families[key];
+  if (auto existing = entry.lock()) {
+    handle = existing;
+    return;
+  }
+
+  // registry only holds weak references, so the count is the number of sessions
+  if (handle.use_count() == 1) {
+    // sole owner, resize in place and keep its size cache
+    std::erase_if(families, [&](const auto& pair) {
+      return pair.second.lock() == handle;
+    });
+    handle->SetSize(size);
+  } else {
+    // copy on write, other sessions keep the current size
+    handle = std::make_shared<FontFamily>(handle->WithSize(size));
+  }
+  families[key] = handle;
 }
@@ -5,18 +5,87 @@
 #include "gfx/texture_atlas.hpp"
 
 #include <array>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <expected>
 
 using FontHandle = std::shared_ptr<Font>;
+
+// Font that is only opened on first use.
+// The path lookup through the font locator starts on a worker thread on creation.
+struct LazyFont {
+  FontDescriptorWithName desc;
+  float linespace = 0;
+  float dpiScale = 1;
+
+  std::shared_future<std::string> path;
+  FontHandle font;
+  bool failed = false;
+  bool sdf = false; // passed to Font
+
+  LazyFont() = default; // empty, Get() returns nullptr
+  LazyFont(FontDescriptorWithName desc, float linespace, float dpiScale);
+  // same font at a different size, reuses the path lookup
+  LazyFont WithSize(float height, float width, float dpiScale) const;
+
+  bool Empty() const {
+    return !path.valid();
+  }
+  // name and style, resolves to the same path for the same id
+  std::string Id() const;
+  // font path, waits for the lookup. Id() if the font wasn't found
+  std::string ResolvedId() const;
+  // waits for the path lookup and opens the font, nullptr if unavailable
+  Font* Get();
+};
+
 // Font is shared with normal if bold/italic/boldItalic is not available
+// or resolves to the same file.
 // If variation exists, it owns its own Font
 struct FontSet {
-  FontHandle normal;
-  FontHandle bold;
-  FontHandle italic;
-  FontHandle boldItalic;
+  LazyFont normal;
+  LazyFont bold;
+  LazyFont italic;
+  LazyFont boldItalic;
+
+  // font for the style, falls back to normal
+  Font* Get(bool isBold, bool isItalic);
+};
+
+struct GlyphKey {
+  char32_t charcode;
+  bool bold;
+  bool italic;
+  auto operator<=>(const GlyphKey&) const = default;
+};
+
+// glyph of a shaped run, offset is relative to the start of the run
+struct ShapedGlyph {
+  char32_t charcode;
+  const GlyphInfo* glyphInfo; // nullptr if drawn by the shapes pipeline
+  glm::vec2 offset; // snapped to a pixel
+  int cell;         // cell index in the run
+  std::optional<uint32_t> gpuDesc; // see BoxDrawing::GpuDesc
+};
+using ShapedRun = std::vector<ShapedGlyph>;
+
+// fonts, box drawing and atlas of a size that isn't active anymore
+struct FontSizeState {
+  int trueHeight; // font height in pixels
+  float dpiScale;
+
+  std::vector<FontSet> fonts;
+  BoxDrawing boxDrawing;
+  TextureAtlas textureAtlas;
+
+  // background rasterization into textureAtlas, wait before using the state
+  std::future<void> prewarm;
 };
 
 // list of fonts: primary font and fallback fonts
@@ -27,14 +96,154 @@ struct FontFamily {
   float defaultHeight;
   float defaultWidth;
 
-  static std::expected<FontFamily, std::string>
-  FromGuifont(std::string guifont, float linespace, float dpiScale);
+  // box chars the shapes pipeline can draw are never rasterized or shaped
+  bool gpuBoxDrawing = false;
+
+  // recently used sizes, front is most recent
+  // going back to a cached size swaps it in instead of rebuilding everything
+  static constexpr size_t maxCachedSizes = 4;
+  std::list<FontSizeState> sizeCache;
+
+  // sdf mode: glyphs are rendered once as distance fields by sdfFonts at
+  // sdfHeight pixels and scaled to the current size. textureAtlas is kept across
+  // size and dpi changes, fonts are only used for metrics.
+  bool sdf = false;
+  static constexpr float sdfHeight = 48;
+  std::vector<FontSet> sdfFonts;
+  // sdfFonts glyphs scaled to the current size
+  std::map<GlyphKey, GlyphInfo> sdfGlyphInfos;
+  // box glyphs are coverage at the cell size, so in sdf mode they go to a bitmap
+  // atlas of their own per size, drawn with the bitmap text pipeline.
+  // textureAtlas is never touched by size changes.
+  TextureAtlas boxAtlas;
+  struct SdfBoxPage {
+    BoxDrawing boxDrawing;
+    TextureAtlas atlas;
+  };
+  // box pages of recent sizes, front is most recent, evicted past maxCachedSizes
+  std::list<SdfBoxPage> sdfBoxCache;
+
+  // lru of shaped runs, front is most recent. glyphs point into the font maps of
+  // the current size, so this is cleared on size changes.
+  static constexpr size_t maxShapedRuns = 4096;
+  std::list<std::pair<std::string, ShapedRun>> shapedRuns;
+  std::unordered_map<std::string, decltype(shapedRuns)::iterator> shapedRunMap;
+
+  struct Size {
+    float height;
+    float width;
+    float dpiScale;
+  };
+
+  // identifies fonts and rasterization settings, see FontFamilyRegistry
+  struct Key {
+    // path of the primary regular face, different spellings of it share a key
+    std::string primaryPath;
+    // names of the fallback font sets, styles and fallbacks stay unresolved
+    std::vector<std::string> fonts;
+    int trueHeight;
+    int trueWidth;
+    int trueLinespace;
+    float dpiScale;
+    bool sdf;
+    bool gpuBoxDrawing;
+    auto operator<=>(const Key&) const = default;
+  };
+
+  // parsed guifont, path lookups are started but no font is opened
+  struct Guifont {
+    std::vector<FontSet> fonts;
+    float height;
+    float width;
+  };
+  static std::expected<Guifont, std::string>
+  ParseGuifont(std::string guifont, float linespace, float dpiScale);
+
+  // opens the primary font and creates the atlas
+  static std::expected<FontFamily, std::string> FromGuifont(
+    Guifont guifont, float dpiScale, bool sdf = false, bool gpuBoxDrawing = false
+  );
+  static std::expected<FontFamily, std::string> FromGuifont(
+    std::string guifont,
+    float linespace,
+    float dpiScale,
+    bool sdf = false,
+    bool gpuBoxDrawing = false
+  );
   // static FontFamily Default(float dpiScale);
 
-  void ChangeDpiScale(float dpiScale);
-  void ChangeSize(float delta);
-  void ResetSize();
+  // key of fonts at size, waits only for the primary path lookup
+  static Key MakeKey(
+    const std::vector<FontSet>& fonts, const Size& size, bool sdf, bool gpuBoxDrawing
+  );
+
+  Size CurrentSize() const;
+  // current size with height changed by delta, keeping the guifont aspect ratio
+  Size DeltaSize(float delta) const;
+  // guifont size at the current dpi scale
+  Size DefaultSize() const;
+
+  Key GetKey(const Size& size) const;
+
+  void SetSize(const Size& size);
+  // copy with fonts and atlas created for size, nothing is shared with this
+  FontFamily WithSize(const Size& size) const;
+
+  // rasterizes printable ascii in the regular style and glyphs into the current
+  // atlas, one worker thread per font, and uploads the atlas once. other styles
+  // are only opened if glyphs use them. call after a font or size change, before
+  // the first frame that uses it.
+  void Prewarm(std::vector<GlyphKey> glyphs);
+  // rasterizes glyphs into the atlases of cached sizes on worker threads
+  void PrewarmCachedSizes(std::vector<GlyphKey> glyphs);
 
   const Font& DefaultFont() const;
-  const GlyphInfo& GetGlyphInfo(char32_t charcode, bool bold, bool italic);
+  // descriptor if charcode is drawn by the shapes pipeline
+  std::optional<uint32_t> GpuBoxDesc(char32_t charcode) const;
+  // glyph of charcode is in boxAtlas instead of textureAtlas
+  bool InBoxAtlas(char32_t charcode) const;
+  // subpixel is the glyph x offset in 1/Font::subpixelBuckets of a pixel
+  const GlyphInfo&
+  GetGlyphInfo(char32_t charcode, bool bold, bool italic, int subpixel = 0);
+  // cellTexts is the text of each cell of a run with the same highlight, each
+  // followed by '\0'. combining marks are centered over their cell, other extra
+  // codepoints in a cell are dropped.
+  // startSubpixel is the subpixel of the run start, glyph offsets are relative to
+  // the pixel the run starts in.
+  const ShapedRun& ShapeRun(
+    const std::string& cellTexts, bool bold, bool italic, int startSubpixel = 0
+  );
+
+private:
+  // creates sdfFonts and the shared atlas for fonts
+  void InitSdf();
+  // prerenders box chars the shapes pipeline doesn't draw
+  void PrerenderBoxDrawing();
 };
+
+using FontFamilyHandle = std::shared_ptr<FontFamily>;
+
+// Process wide registry of font families.
+// Sessions with identical fonts and sizes share one FontFamily (faces, glyphs and
+// atlas). Changing the size of a shared family makes a copy for that session.
+struct FontFamilyRegistry {
+  std::map<FontFamily::Key, std::weak_ptr<FontFamily>> families;
+
+  std::expected<FontFamilyHandle, std::string> FromGuifont(
+    std::string guifont,
+    float linespace,
+    float dpiScale,
+    bool sdf = false,
+    bool gpuBoxDrawing = false
+  );
+
+  // these replace handle with the family at the new size
+  void ChangeDpiScale(FontFamilyHandle& handle, float dpiScale);
+  void ChangeSize(FontFamilyHandle& handle, float delta);
+  void ResetSize(FontFamilyHandle& handle);
+
+private:
+  void SetSize(FontFamilyHandle& handle, const FontFamily::Size& size);
+};
+
+inline FontFamilyRegistry fontFamilyRegistry;
@@ -0,0 +1,29 @@
+#include "row_cache.hpp"
+#include <iterator>
+
+void RowCache::Store(const Grid& grid, int scrollRow, int start, int end) {
+  for (int row = start; row < end; row++) {
+    rows[scrollRow + row] = grid.lines[row];
+  }
+
+  // drop rows too far from the viewport to be scrolled to
+  int keep = screens * (end - start);
+  rows.erase(rows.begin(), rows.lower_bound(scrollRow + start - keep));
+  rows.erase(rows.lower_bound(scrollRow + end + keep), rows.end());
+}
+
+const Grid::Line* RowCache::Find(int row) const {
+  auto it = rows.find(row);
+  return it == rows.end() ? nullptr : &it->second;
+}
+
+bool RowCache::Contains(int start, int end) const {
+  // keys are unique, so the range is complete if it has end - start rows
+  auto first = rows.lower_bound(start);
+  auto last = rows.lower_bound(end);
+  return std::distance(first, last) == end - start;
+}
+
+void RowCache::Clear() {
+  rows.clear();
+}
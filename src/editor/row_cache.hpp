@@ -0,0 +1,22 @@
+#pragma once
+
+#include "editor/grid.hpp"
+#include <map>
+
+// Recently visible rows of a window, keyed by scroll row (sum of win_viewport
+// scroll deltas). Lets long jumps animate over content that has already been
+// seen instead of snapping. Rows are snapshots and may be stale.
+struct RowCache {
+  // rows kept on each side of the viewport, in viewport heights
+  static constexpr int screens = 3;
+
+  std::map<int, Grid::Line> rows;
+
+  // snapshots grid rows [start, end), grid row 0 is at scrollRow
+  void Store(const Grid& grid, int scrollRow, int start, int end);
+  // nullptr if not cached
+  const Grid::Line* Find(int row) const;
+  // true if every row in [start, end) is cached
+  bool Contains(int start, int end) const;
+  void Clear();
+};
@@ -2,7 +2,9 @@
 #include "glm/gtx/string_cast.hpp"
 #include "utils/color.hpp"
 #include "utils/logger.hpp"
+#include "utils/unicode.hpp"
 #include <deque>
+#include <set>
 #include <utility>
 #include <vector>
 #include "utils/variant.hpp"
@@ -298,6 +300,9 @@ void ParseEditorState(UiEvents& uiEvents, EditorState& editorState) {
           for (auto* e : msgSetPos) {
             editorState.winManager.MsgSetPos(*e);
           }
+
+          // keep what's on screen for animating long jumps back to it
+          editorState.winManager.CacheRows();
         },
         [&](auto& _e) {
           auto* e = (UiEvent*)&_e;
@@ -319,3 +324,21 @@ void ParseEditorState(UiEvents& uiEvents, EditorState& editorState) {
   }
 }
 // clang-format on
+
+std::vector<GlyphKey> GetVisibleGlyphs(const EditorState& editorState) {
+  std::set<GlyphKey> glyphs;
+  for (const auto& [id, win] : editorState.winManager.windows) {
+    if (win.hidden) continue;
+    const auto& lines = win.grid.lines;
+    for (size_t row = 0; row < lines.Size(); row++) {
+      for (const auto& cell : lines[row]) {
+        if (cell.text.empty() || cell.text == " ") continue;
+        auto hlIt = editorState.hlTable.find(cell.hlId);
+        bool bold = hlIt != editorState.hlTable.end() && hlIt->second.bold;
+        bool italic = hlIt != editorState.hlTable.end() && hlIt->second.italic;
+        glyphs.insert({UTF8ToChar32(cell.text), bold, italic});
+      }
+    }
+  }
+  return {glyphs.begin(), glyphs.end()};
+}
@@ -17,8 +17,11 @@ struct EditorState {
   HlTable hlTable;
   Cursor cursor;
   std::vector<CursorMode> cursorModes;
-  FontFamily fontFamily;
+  FontFamilyHandle fontFamily;
   // std::map<int, std::string> hlGroupTable;
 };
 
 void ParseEditorState(UiEvents& uiEvents, EditorState& editorState);
+
+// unique glyphs currently displayed in visible windows
+std::vector<GlyphKey> GetVisibleGlyphs(const EditorState& editorState);
@@ -3,11 +3,16 @@
 #include "glm/gtx/string_cast.hpp"
 #include "utils/logger.hpp"
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <utility>
 
 using namespace wgpu;
 
+// color glyphs and sdf mode box glyphs are rare, the buffers grow when needed
+static constexpr size_t colorQuads = 16;
+static constexpr size_t boxQuads = 16;
+
 void WinManager::InitRenderData(Win& win) {
   auto pos = glm::vec2(win.startCol, win.startRow) * sizes.charSize;
   auto size = glm::vec2(win.width, win.height) * sizes.charSize;
@@ -15,36 +20,44 @@ void WinManager::InitRenderData(Win& win) {
   auto numQuads = win.height * std::min(win.width, 80);
   win.rectData.CreateBuffers(numQuads);
   win.textData.CreateBuffers(numQuads);
+  win.colorTextData.CreateBuffers(colorQuads);
+  win.boxTextData.CreateBuffers(boxQuads);
   win.shapeData.CreateBuffers(numQuads);
 
   win.sRenderTexture = ScrollableRenderTexture(size, sizes.dpiScale, sizes.charSize);
   win.sRenderTexture.UpdatePos(pos);
 
   win.grid.dirty = true;
+  occlusionDirty = true;
 
   win.pos = pos;
   win.size = size;
 }
 
-void WinManager::UpdateRenderData(Win& win) {
+void WinManager::UpdateRenderData(Win& win, bool force) {
   auto pos = glm::vec2(win.startCol, win.startRow) * sizes.charSize;
   auto size = glm::vec2(win.width, win.height) * sizes.charSize;
 
   bool posChanged = pos != win.pos;
   // sometimes size can be equal, but charSize different
   // for hidden window, win.sRenderTexture.charSize will always be vec2(0, 0)
-  bool sizeChanged = size != win.size || sizes.charSize != win.sRenderTexture.charSize;
+  bool sizeChanged =
+    force || size != win.size || sizes.charSize != win.sRenderTexture.charSize;
   if (!posChanged && !sizeChanged) {
     return;
   }
 
   if (sizeChanged) {
-    auto numQuads = win.height * std::min(win.width, 80);
-    win.rectData.CreateBuffers(numQuads);
-    win.textData.CreateBuffers(numQuads);
-    win.shapeData.CreateBuffers(numQuads);
+    // buffers grow when needed, only recreate them up front for a larger window
+    size_t numQuads = win.height * std::min(win.width, 80);
+    if (win.rectData.quads.size() < numQuads) {
+      win.rectData.CreateBuffers(numQuads);
+      win.textData.CreateBuffers(numQuads);
+      win.shapeData.CreateBuffers(numQuads);
+    }
 
     win.sRenderTexture = ScrollableRenderTexture(size, sizes.dpiScale, sizes.charSize);
+    win.rowCache.Clear();
   }
   win.sRenderTexture.UpdatePos(pos);
 
@@ -53,11 +66,54 @@ void WinManager::UpdateRenderData(Win& win) {
   }
 
   win.grid.dirty = true;
+  occlusionDirty = true;
 
   win.pos = pos;
   win.size = size;
 }
 
+void WinManager::UpdateOrder(const Win& win) {
+  RemoveFromOrder(win.id);
+  // hidden message window keeps its place, it's still composited
+  if (win.hidden && win.id != msgWinId) return;
+
+  if (win.IsFloating()) {
+    // higher zindex first, same zindex in id order
+    auto key = [](const Win* w) { return std::pair(-w->floatData->zindex, w->id); };
+    auto it = std::ranges::find_if(floatOrder, [&](const Win* other) {
+      return key(other) > key(&win);
+    });
+    floatOrder.insert(it, &win);
+  } else {
+    // message window first, default grid last
+    auto key = [this](const Win* w) {
+      return std::pair(w->id == msgWinId ? 0 : w->id == 1 ? 2 : 1, w->id);
+    };
+    auto it = std::ranges::find_if(splitOrder, [&](const Win* other) {
+      return key(other) > key(&win);
+    });
+    splitOrder.insert(it, &win);
+  }
+}
+
+void WinManager::RemoveFromOrder(int id) {
+  auto isWin = [id](const Win* win) { return win->id == id; };
+  std::erase_if(splitOrder, isWin);
+  std::erase_if(floatOrder, isWin);
+  occlusionDirty = true;
+}
+
+void WinManager::UpdateSizes(const SizeHandler& newSizes) {
+  std::lock_guard lock(windowsMutex);
+  sizes = newSizes;
+  for (auto& [id, win] : windows) {
+    // hidden windows get render data when shown again
+    if (win.hidden) continue;
+    UpdateRenderData(win, true);
+  }
+  dirty = true;
+}
+
 void WinManager::Pos(const event::WinPos& e) {
   std::lock_guard lock(windowsMutex);
   auto gridIt = gridManager->grids.find(e.grid);
@@ -83,6 +139,7 @@ void WinManager::Pos(const event::WinPos& e) {
   } else {
     UpdateRenderData(win);
   }
+  UpdateOrder(win);
 }
 
 // TODO: find a more robust way to handle
@@ -109,6 +166,7 @@ void WinManager::FloatPos(int grid) {
   win.hidden = false;
 
   UpdateRenderData(win);
+  UpdateOrder(win);
 }
 
 void WinManager::FloatPos(const event::WinFloatPos& e) {
@@ -167,6 +225,7 @@ void WinManager::FloatPos(const event::WinFloatPos& e) {
   } else {
     UpdateRenderData(win);
   }
+  UpdateOrder(win);
 }
 
 void WinManager::ExternalPos(const event::WinExternalPos& e) {
@@ -181,6 +240,7 @@ void WinManager::Hide(const event::WinHide& e) {
   }
   auto& win = it->second;
   win.hidden = true;
+  UpdateOrder(win);
 
   // save memory when window gets hidden (e.g. switching tabs)
   win.sRenderTexture = {};
@@ -188,6 +248,7 @@ void WinManager::Hide(const event::WinHide& e) {
 
 void WinManager::Close(const event::WinClose& e) {
   std::lock_guard lock(windowsMutex);
+  RemoveFromOrder(e.grid);
   auto removed = windows.erase(e.grid);
   if (removed == 0) {
     // see editor/state.cpp GridDestroy
@@ -227,6 +288,7 @@ void WinManager::MsgSetPos(const event::MsgSetPos& e) {
   } else {
     UpdateRenderData(win);
   }
+  UpdateOrder(win);
 }
 
 void WinManager::Viewport(const event::WinViewport& e) {
@@ -238,15 +300,37 @@ void WinManager::Viewport(const event::WinViewport& e) {
   }
   auto& win = it->second;
 
-  bool shouldScroll =              //
-    std::abs(e.scrollDelta) > 0 && //
-    std::abs(e.scrollDelta) <= win.height - (win.margins.top + win.margins.bottom);
+  // edits and buffer switches shift or replace content, cached rows are stale
+  if (e.lineCount != win.lineCount ||
+      (e.scrollDelta == 0 && e.topline != win.topline)) {
+    win.rowCache.Clear();
+  }
+
+  int innerHeight = win.height - (win.margins.top + win.margins.bottom);
+  int distance = std::abs(e.scrollDelta);
+  bool shouldScroll = distance > 0 && distance <= innerHeight;
+
+  // long jumps animate too if the rows between the viewports have been seen
+  int cachedRows = 0;
+  if (distance > innerHeight && win.grid.height == win.height) {
+    int gapStart =
+      win.scrollRow + win.margins.top + innerHeight + std::min(e.scrollDelta, 0);
+    int gapRows = distance - innerHeight;
+    if (win.rowCache.Contains(gapStart, gapStart + gapRows)) {
+      shouldScroll = true;
+      cachedRows = gapRows;
+    }
+  }
+
+  win.topline = e.topline;
+  win.lineCount = e.lineCount;
+  win.scrollRow += e.scrollDelta;
 
   // LOG_INFO("WinManager::Viewport: grid {} scrollDelta {} shouldScroll {}", e.grid,
 
   if (!shouldScroll) return;
   float scrollDist = e.scrollDelta * sizes.charSize.y;
-  win.sRenderTexture.UpdateViewport(scrollDist);
+  win.sRenderTexture.UpdateViewport(scrollDist, cachedRows);
 }
 
 void WinManager::UpdateScrolling(float dt) {
@@ -277,6 +361,93 @@ bool WinManager::ViewportMargins(const event::WinViewportMargins& e) {
   return true;
 }
 
+void WinManager::CacheRows() {
+  std::lock_guard lock(windowsMutex);
+  for (auto& [id, win] : windows) {
+    if (win.hidden || win.lineCount == -1 || !win.grid.dirty) continue;
+    // margins don't scroll
+    int start = win.margins.top;
+    int end = std::min(win.grid.height, win.height) - win.margins.bottom;
+    if (start >= end) continue;
+    win.rowCache.Store(win.grid, win.scrollRow, start, end);
+  }
+}
+
+void WinManager::UpdateOcclusion() {
+  std::lock_guard lock(windowsMutex);
+
+  std::vector<std::pair<int, bool>> newFloatOpacity;
+  newFloatOpacity.reserve(floatOrder.size());
+  for (const Win* win : floatOrder) {
+    newFloatOpacity.emplace_back(win->id, win->opaque);
+  }
+  if (!occlusionDirty && newFloatOpacity == floatOpacity) return;
+  occlusionDirty = false;
+  floatOpacity = std::move(newFloatOpacity);
+  dirty = true;
+
+  // cells covered by any window, the default grid usually spans all of them
+  int uiWidth = 0;
+  int uiHeight = 0;
+  for (const auto& [id, win] : windows) {
+    uiWidth = std::max(uiWidth, win.startCol + win.width);
+    uiHeight = std::max(uiHeight, win.startRow + win.height);
+  }
+  std::vector<uint8_t> covered(uiWidth * uiHeight, false);
+
+  auto cover = [&](const Win& win) {
+    int rowStart = std::max(win.startRow, 0);
+    int rowEnd = std::min(win.startRow + win.height, uiHeight);
+    int colStart = std::max(win.startCol, 0);
+    int colEnd = std::min(win.startCol + win.width, uiWidth);
+    for (int row = rowStart; row < rowEnd; row++) {
+      auto line = covered.begin() + row * uiWidth;
+      std::fill(line + colStart, line + colEnd, true);
+    }
+  };
+
+  // sets visible rows of the window to the rows with uncovered cells
+  auto updateVisibility = [&](const Win* constWin) {
+    auto& win = windows.at(constWin->id);
+    int firstRow = win.height;
+    int lastRow = 0;
+    if (!win.hidden) {
+      int colStart = std::max(win.startCol, 0);
+      int colEnd = std::min(win.startCol + win.width, uiWidth);
+      for (int row = 0; row < win.height; row++) {
+        int uiRow = win.startRow + row;
+        if (uiRow < 0 || uiRow >= uiHeight) continue;
+        auto line = covered.begin() + uiRow * uiWidth;
+        if (std::find(line + colStart, line + colEnd, false) == line + colEnd) {
+          continue;
+        }
+        firstRow = std::min(firstRow, row);
+        lastRow = row + 1;
+      }
+    }
+
+    win.occluded = firstRow >= lastRow;
+    if (!win.occluded) win.sRenderTexture.SetVisibleRows(firstRow, lastRow);
+  };
+
+  // floats hide lower floats whether opaque or not, the stencil keeps the
+  // first float drawn
+  for (const Win* win : floatOrder) {
+    updateVisibility(win);
+    if (!win->hidden) cover(*win);
+  }
+
+  // splits are composited under floats, only opaque floats hide them
+  std::ranges::fill(covered, false);
+  for (const Win* win : floatOrder) {
+    if (!win->hidden && win->opaque) cover(*win);
+  }
+  for (const Win* win : splitOrder) {
+    updateVisibility(win);
+    if (!win->hidden) cover(*win);
+  }
+}
+
 void WinManager::Extmark(const event::WinExtmark& e) {
 }
 
@@ -6,10 +6,13 @@
 
 #include "utils/margins.hpp"
 #include "editor/grid.hpp"
+#include "editor/row_cache.hpp"
 #include "app/size.hpp"
 
 #include "glm/ext/vector_float2.hpp"
 #include <map>
+#include <utility>
+#include <vector>
 #include <optional>
 
 struct FloatData {
@@ -43,9 +46,25 @@ struct Win {
 
   QuadRenderData<RectQuadVertex, true> rectData;
   QuadRenderData<TextQuadVertex, true> textData;
+  // color glyphs, sampled from the atlas color page
+  QuadRenderData<TextQuadVertex, true> colorTextData;
+  // box glyphs of the sdf font mode, sampled from FontFamily::boxAtlas
+  QuadRenderData<TextQuadVertex, true> boxTextData;
   QuadRenderData<ShapeQuadVertex, true> shapeData;
 
   ScrollableRenderTexture sRenderTexture;
+  // every background drawn is opaque, set when rendered. only opaque floats
+  // hide the splits behind them
+  bool opaque = false;
+  // no cell is visible, rendering is skipped and the grid stays dirty
+  bool occluded = false;
+
+  // viewport from win_viewport, -1 until the first event. scrollRow is the scroll
+  // row of grid row 0, and keys rowCache
+  int topline = -1;
+  int lineCount = -1;
+  int scrollRow = 0;
+  RowCache rowCache;
 };
 
 // for input handler
@@ -65,15 +84,31 @@ struct WinManager {
   std::map<int, Win> windows;
   int msgWinId = -1;
 
+  // composition order, front to back. kept in sync by window events
+  // message window, splits, then the default grid
+  std::vector<const Win*> splitOrder;
+  // floats by zindex
+  std::vector<const Win*> floatOrder;
+
+  // occlusion is recomputed when the layout or opacity of floats changes
+  bool occlusionDirty = true;
+  std::vector<std::pair<int, bool>> floatOpacity;
+
   // added to public functions called in main thread that reads (main thread doesn't write)
   // added to public functions called in render thread that writes
   mutable std::mutex windowsMutex;
 
 private:
   void InitRenderData(Win& win);
-  void UpdateRenderData(Win& win);
+  // force recreates textures even if the window size didn't change
+  void UpdateRenderData(Win& win, bool force = false);
+  void UpdateOrder(const Win& win);
+  void RemoveFromOrder(int id);
 
 public:
+  // rebuilds render data of all windows for new char size or dpi scale, grids are
+  // rendered again from retained cells without nvim resending them
+  void UpdateSizes(const SizeHandler& newSizes);
   void Pos(const event::WinPos& e);
   void FloatPos(int grid);
   void FloatPos(const event::WinFloatPos& e);
@@ -84,6 +119,10 @@ public:
   void Viewport(const event::WinViewport& e);
   void UpdateScrolling(float dt);
   bool ViewportMargins(const event::WinViewportMargins& e);
+  // snapshots visible rows of changed windows, call after each flush
+  void CacheRows();
+  // cell granular, sets Win::occluded and trims composition to visible rows
+  void UpdateOcclusion();
   void Extmark(const event::WinExtmark& e);
 
   Grid* GetGrid(int id);
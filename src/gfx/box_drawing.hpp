@@ -3,12 +3,13 @@
 #include "gfx/pen.hpp"
 #include "gfx/texture_atlas.hpp"
 #include "glm/ext/vector_float2.hpp"
+#include <functional>
 #include <mdspan>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
-void PopulateBoxChars();
-
+// procedurally drawn box drawing, block element and braille characters
 struct BoxDrawing {
   glm::vec2 size;
   float dpiScale;
@@ -25,6 +26,24 @@ struct BoxDrawing {
   BoxDrawing() = default;
   BoxDrawing(glm::vec2 size, float dpiScale);
 
+  // whether charcode is in a range handled here
+  static bool Contains(char32_t charcode);
+
+  // shape type of box chars in the shapes pipeline
+  static constexpr uint32_t gpuShapeType = 5;
+  // compact descriptor evaluated by shapes.wgsl, see the encoding in GpuDesc.
+  // nullopt if the char can't be drawn by the shader (double line joins, braille)
+  static std::optional<uint32_t> GpuDesc(char32_t charcode);
+
   // returns nullptr if not implemented
   const GlyphInfo* GetGlyphInfo(char32_t charcode, TextureAtlas& textureAtlas);
+  // rasterizes all implemented chars in parallel and adds them to the atlas.
+  // only chars include returns true for, if given
+  void Prerender(
+    TextureAtlas& textureAtlas, const std::function<bool(char32_t)>& include = {}
+  );
+
+private:
+  const GlyphInfo&
+  AddGlyph(char32_t charcode, box::BufType glyphCanvas, TextureAtlas& textureAtlas);
 };
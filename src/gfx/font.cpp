@@ -3,22 +3,80 @@
 #include "utils/logger.hpp"
 #include "utils/region.hpp"
 #include "glm/gtx/string_cast.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
 #include <mdspan>
+#include <mutex>
+#include <span>
+#include <vector>
 
 #include "freetype/ftmodapi.h"
+#include "freetype/ftoutln.h"
 
 using namespace wgpu;
 
-static FT_FacePtr
-CreateFace(FT_Library library, const char* filepath, FT_Long face_index) {
+static FT_Library library;
+// creating and destroying faces modifies the library, other FT calls are per face
+static std::mutex libraryMutex;
+
+// font files mapped once and shared between sizes, styles and sessions.
+// guarded by libraryMutex.
+static std::map<std::string, std::weak_ptr<const MappedFile>> fontFiles;
+
+static std::shared_ptr<const MappedFile> GetFontFile(const std::string& path) {
+  auto& weakFile = fontFiles[path];
+  if (auto file = weakFile.lock()) {
+    return file;
+  }
+  std::erase_if(fontFiles, [](const auto& pair) { return pair.second.expired(); });
+
+  auto file = std::make_shared<const MappedFile>(path);
+  if (!*file) {
+    LOG_WARN("Failed to map font file: {}", path);
+    return nullptr;
+  }
+  fontFiles[path] = file;
+  return file;
+}
+
+// face is created from the shared mapping if possible, file is set to it.
+// falls back to FreeType reading the file.
+static FT_FacePtr CreateFace(
+  FT_Library library,
+  const std::string& filepath,
+  FT_Long face_index,
+  std::shared_ptr<const MappedFile>& file
+) {
+  std::lock_guard lock(libraryMutex);
   FT_Face face;
-  if (FT_New_Face(library, filepath, face_index, &face)) {
+  file = GetFontFile(filepath);
+  if (file) {
+    if (FT_New_Memory_Face(
+          library, file->data, FT_Long(file->size), face_index, &face
+        )) {
+      file = nullptr;
+      return nullptr;
+    }
+    return FT_FacePtr(face);
+  }
+
+  if (FT_New_Face(library, filepath.c_str(), face_index, &face)) {
     return nullptr;
   }
   return FT_FacePtr(face);
 }
 
-static FT_Library library;
+void FtDoneFace(FT_Face face) {
+  std::lock_guard lock(libraryMutex);
+  FT_Done_Face(face);
+}
+
+// glyph cache files are keyed by these, change them together
+static constexpr FT_Int32 loadFlags = FT_LOAD_DEFAULT;
+static constexpr FT_Int32 colorLoadFlags = loadFlags | FT_LOAD_COLOR;
+static constexpr FT_Render_Mode renderMode = FT_RENDER_MODE_NORMAL;
+static constexpr FT_Render_Mode sdfRenderMode = FT_RENDER_MODE_SDF;
 
 int FtInit() {
   auto error = FT_Init_FreeType(&library);
@@ -59,11 +117,16 @@ Font::FromName(const FontDescriptorWithName& desc, float linespace, float dpiSca
 }
 
 Font::Font(
-  std::string _path, float _height, float _width, float _linespace, float _dpiScale
+  std::string _path,
+  float _height,
+  float _width,
+  float _linespace,
+  float _dpiScale,
+  bool _sdf
 )
     : path(std::move(_path)), height(_height), width(_width), linespace(_linespace),
-      dpiScale(_dpiScale) {
-  if (face = CreateFace(library, path.c_str(), 0); face == nullptr) {
+      dpiScale(_dpiScale), sdf(_sdf) {
+  if (face = CreateFace(library, path, 0, file); face == nullptr) {
     throw std::runtime_error("Failed to create FT_Face for: " + path);
   }
 
@@ -71,8 +134,13 @@ Font::Font(
   int trueHeight = height * dpiScale;
   height = trueHeight / dpiScale; // round down to nearest trueSize
 
-  int trueWidth = width * dpiScale;
-  width = trueWidth / dpiScale; // round down to nearest trueWidth
+  // whole pixel cell width by default. a guifont width that is fractional in
+  // pixels keeps its fraction, and glyphs get subpixel variants
+  float trueWidth = width * dpiScale;
+  fractionalWidth = trueWidth != std::floor(trueWidth);
+  if (!fractionalWidth) {
+    width = trueWidth / dpiScale;
+  }
 
   auto roundPixel = [this](float val) -> float {
     return int(val * dpiScale) / dpiScale;
@@ -80,10 +148,39 @@ Font::Font(
   linespace = roundPixel(linespace);
   float topLinespace = roundPixel(linespace / 2);
 
-  FT_Set_Pixel_Sizes(face.get(), trueWidth, trueHeight);
-  charSize.x = (face->size->metrics.max_advance >> 6) / dpiScale;
-  charSize.y = (face->size->metrics.height >> 6) / dpiScale;
-  ascender = (face->size->metrics.ascender >> 6) / dpiScale;
+  color = FT_HAS_COLOR(face);
+  if (FT_IS_SCALABLE(face) || face->num_fixed_sizes == 0) {
+    // 72 dpi makes char size in points equal to pixels
+    FT_Set_Char_Size(
+      face.get(), FT_F26Dot6(trueWidth * 64), FT_F26Dot6(trueHeight) * 64, 72, 72
+    );
+  } else {
+    // bitmap emoji fonts only have fixed strikes, pick the smallest one that is
+    // at least trueHeight, and scale glyphs down when rasterizing
+    int strike = 0;
+    for (int i = 1; i < face->num_fixed_sizes; i++) {
+      int size = face->available_sizes[i].height;
+      int best = face->available_sizes[strike].height;
+      if ((best < trueHeight && size > best) ||
+          (size >= trueHeight && size < best)) {
+        strike = i;
+      }
+    }
+    FT_Select_Size(face.get(), strike);
+    strikeScale = float(trueHeight) / face->size->metrics.y_ppem;
+  }
+
+  auto toSize = [this](FT_Pos val) -> float {
+    return (val >> 6) * strikeScale / dpiScale;
+  };
+  charSize.x = toSize(face->size->metrics.max_advance);
+  if (fractionalWidth && FT_IS_SCALABLE(face)) {
+    // unrounded advance, metrics.max_advance is rounded to whole pixels
+    auto maxAdvance = FT_MulFix(face->max_advance_width, face->size->metrics.x_scale);
+    charSize.x = maxAdvance / 64.0f / dpiScale;
+  }
+  charSize.y = toSize(face->size->metrics.height);
+  ascender = toSize(face->size->metrics.ascender);
 
   charSize.y += linespace;
   ascender += topLinespace;
@@ -93,6 +190,15 @@ Font::Font(
   underlineThickness = (FT_MulFix(face->underline_thickness, y_scale) >> 6) / dpiScale;
   underlineThickness = std::max(underlineThickness, 1.0f / dpiScale);
 
+  glyphCache = GlyphCache({
+    .fontHash = GlyphCache::HashFontFile(path),
+    .pixelWidth = uint32_t(std::lround(trueWidth * 64)),
+    .pixelHeight = uint32_t(trueHeight),
+    .dpiScale = dpiScale,
+    .loadFlags = color ? colorLoadFlags : loadFlags,
+    .renderMode = sdf ? sdfRenderMode : renderMode,
+  });
+
   // LOG_INFO(
   //   "Font: {}, size: {}, dpiScale: {}, charSize: {}, ascender: {}, underlinePosition: "
   //   "{}, underlineThickness: {}",
@@ -101,43 +207,200 @@ Font::Font(
   // );
 }
 
+// subpixel is clamped to the buckets, and 0 for sdf
+static FT_UInt VariantKey(FT_UInt glyphIndex, int& subpixel, bool sdf) {
+  subpixel = sdf ? 0 : std::clamp(subpixel, 0, Font::subpixelBuckets - 1);
+  return glyphIndex * Font::subpixelBuckets + subpixel;
+}
+
+FT_GlyphSlot Font::RenderGlyph(FT_UInt glyphIndex, int subpixel) {
+  FT_Load_Glyph(face.get(), glyphIndex, color ? colorLoadFlags : loadFlags);
+  FT_GlyphSlot slot = face->glyph;
+  if (subpixel != 0 && slot->format == FT_GLYPH_FORMAT_OUTLINE) {
+    FT_Outline_Translate(&slot->outline, subpixel * 64 / subpixelBuckets, 0);
+  }
+  // color bitmaps (CBDT, sbix) are loaded already rendered
+  if (slot->format != FT_GLYPH_FORMAT_BITMAP) {
+    FT_Render_Glyph(slot, sdf ? sdfRenderMode : renderMode);
+  }
+  return slot;
+}
+
+const GlyphInfo* Font::AddGlyph(
+  FT_UInt variantKey,
+  int left,
+  int top,
+  std::mdspan<const uint8_t, std::dextents<size_t, 2>> bitmap,
+  TextureAtlas& textureAtlas
+) {
+  auto region = textureAtlas.AddGlyph(bitmap, sdf);
+
+  auto pair = glyphInfoMap.emplace(
+    variantKey,
+    GlyphInfo{
+      .localPoss = MakeRegion(
+        {
+          left / dpiScale,
+          -top / dpiScale,
+        },
+        {
+          bitmap.extent(1) / dpiScale,
+          bitmap.extent(0) / dpiScale,
+        }
+      ),
+      .atlasRegion = region,
+    }
+  );
+
+  return &(pair.first->second);
+}
+
 const GlyphInfo*
-Font::GetGlyphInfo(char32_t charcode, TextureAtlas& textureAtlas) {
+Font::GetGlyphInfo(char32_t charcode, TextureAtlas& textureAtlas, int subpixel) {
   auto glyphIndex = FT_Get_Char_Index(face.get(), charcode);
 
   if (glyphIndex == 0) {
     return nullptr;
   }
 
-  auto it = glyphInfoMap.find(glyphIndex);
+  // variants of a glyph are stored under separate keys, in the map and glyph cache
+  FT_UInt variantKey = VariantKey(glyphIndex, subpixel, sdf);
+
+  auto it = glyphInfoMap.find(variantKey);
   if (it != glyphInfoMap.end()) {
     return &(it->second);
   }
 
-  FT_Int32 loadFlags = FT_LOAD_DEFAULT;
-  FT_Load_Glyph(face.get(), glyphIndex, loadFlags);
-  FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL);
+  // rasterized ahead of time by Rasterize
+  if (auto pendingIt = pendingGlyphs.find(variantKey);
+      pendingIt != pendingGlyphs.end()) {
+    const auto& pending = pendingIt->second;
+    glyphCache.Add(
+      variantKey, pending.left, pending.top, pending.width, pending.rows,
+      pending.width, pending.bitmap.data()
+    );
+    auto view = std::mdspan(pending.bitmap.data(), pending.rows, pending.width);
+    auto* glyphInfo =
+      AddGlyph(variantKey, pending.left, pending.top, view, textureAtlas);
+    pendingGlyphs.erase(pendingIt);
+    return glyphInfo;
+  }
 
-  FT_GlyphSlot slot = face->glyph;
+  // skip freetype entirely if the bitmap was rasterized before
+  if (auto cached = glyphCache.Find(variantKey)) {
+    const auto& entry = *cached->entry;
+    return AddGlyph(variantKey, entry.left, entry.top, cached->bitmap, textureAtlas);
+  }
+
+  FT_GlyphSlot slot = RenderGlyph(glyphIndex, subpixel);
   FT_Bitmap& bitmap = slot->bitmap;
+  if (bitmap.pixel_mode == FT_PIXEL_MODE_BGRA) {
+    return AddColorGlyph(variantKey, textureAtlas);
+  }
+
+  glyphCache.Add(
+    variantKey, slot->bitmap_left, slot->bitmap_top, bitmap.width, bitmap.rows,
+    bitmap.pitch, bitmap.buffer
+  );
+
+  auto view = std::mdspan<const uint8_t, std::dextents<size_t, 2>>(
+    bitmap.buffer, bitmap.rows, bitmap.width
+  );
+  return AddGlyph(variantKey, slot->bitmap_left, slot->bitmap_top, view, textureAtlas);
+}
+
+void Font::Rasterize(
+  std::span<const char32_t> charcodes, std::span<const int> subpixels
+) {
+  for (char32_t charcode : charcodes) {
+    auto glyphIndex = FT_Get_Char_Index(face.get(), charcode);
+    if (glyphIndex == 0) continue;
+
+    for (int subpixel : subpixels) {
+      FT_UInt variantKey = VariantKey(glyphIndex, subpixel, sdf);
+      if (glyphInfoMap.contains(variantKey) || pendingGlyphs.contains(variantKey) ||
+          glyphCache.Find(variantKey)) {
+        continue;
+      }
+
+      FT_GlyphSlot slot = RenderGlyph(glyphIndex, subpixel);
+      const FT_Bitmap& bitmap = slot->bitmap;
+      // color glyphs are scaled and added on the render thread
+      if (bitmap.pixel_mode == FT_PIXEL_MODE_BGRA) continue;
+
+      PendingGlyph pending{
+        .left = slot->bitmap_left,
+        .top = slot->bitmap_top,
+        .width = bitmap.width,
+        .rows = bitmap.rows,
+      };
+      pending.bitmap.reserve(size_t(bitmap.width) * bitmap.rows);
+      for (uint32_t row = 0; row < bitmap.rows; row++) {
+        const uint8_t* src = bitmap.buffer + ptrdiff_t(row) * bitmap.pitch;
+        pending.bitmap.insert(pending.bitmap.end(), src, src + bitmap.width);
+      }
+      pendingGlyphs.emplace(variantKey, std::move(pending));
+    }
+  }
+}
+
+const GlyphInfo*
+Font::AddColorGlyph(FT_UInt variantKey, TextureAtlas& textureAtlas) {
+  FT_GlyphSlot slot = face->glyph;
+  const FT_Bitmap& bitmap = slot->bitmap;
+
+  // fit the glyph into the cell height
+  float scale = strikeScale;
+  float maxRows = charSize.y * dpiScale;
+  if (bitmap.rows * scale > maxRows) scale = maxRows / bitmap.rows;
+
+  size_t width = std::max<size_t>(std::lround(bitmap.width * scale), 1);
+  size_t rows = std::max<size_t>(std::lround(bitmap.rows * scale), 1);
+
+  // box filter from premultiplied bgra to premultiplied rgba
+  std::vector<TextureAtlas::Color> pixels(width * rows);
+  for (size_t row = 0; row < rows; row++) {
+    size_t srcRow0 = row * bitmap.rows / rows;
+    size_t srcRow1 = std::max((row + 1) * bitmap.rows / rows, srcRow0 + 1);
+    for (size_t col = 0; col < width; col++) {
+      size_t srcCol0 = col * bitmap.width / width;
+      size_t srcCol1 = std::max((col + 1) * bitmap.width / width, srcCol0 + 1);
+
+      uint32_t sum[4]{};
+      for (size_t y = srcRow0; y < srcRow1; y++) {
+        const uint8_t* src = bitmap.buffer + ptrdiff_t(y) * bitmap.pitch;
+        for (size_t x = srcCol0; x < srcCol1; x++) {
+          for (size_t i = 0; i < 4; i++) sum[i] += src[x * 4 + i];
+        }
+      }
+      uint32_t count = (srcRow1 - srcRow0) * (srcCol1 - srcCol0);
+      pixels[row * width + col] = {
+        .r = uint8_t(sum[2] / count),
+        .g = uint8_t(sum[1] / count),
+        .b = uint8_t(sum[0] / count),
+        .a = uint8_t(sum[3] / count),
+      };
+    }
+  }
 
-  auto view = std::mdspan(bitmap.buffer, bitmap.rows, bitmap.width);
-  auto region = textureAtlas.AddGlyph(view);
+  auto view = std::mdspan(pixels.data(), rows, width);
+  auto region = textureAtlas.ColorPage().AddGlyph(view);
 
   auto pair = glyphInfoMap.emplace(
-    glyphIndex,
+    variantKey,
     GlyphInfo{
       .localPoss = MakeRegion(
         {
-          slot->bitmap_left / dpiScale,
-          -slot->bitmap_top / dpiScale,
+          slot->bitmap_left * scale / dpiScale,
+          -slot->bitmap_top * scale / dpiScale,
         },
         {
-          bitmap.width / dpiScale,
-          bitmap.rows / dpiScale,
+          width / dpiScale,
+          rows / dpiScale,
         }
       ),
       .atlasRegion = region,
+      .color = true,
     }
   );
 
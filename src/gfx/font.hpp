@@ -3,7 +3,14 @@
 #include "gfx/font/descriptor.hpp"
 #include "gfx/texture_atlas.hpp"
 #include "gfx/glyph_info.hpp"
+#include "gfx/glyph_cache.hpp"
+#include "utils/mapped_file.hpp"
 #include <expected>
+#include <mdspan>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
 
 #include <ft2build.h>
 #include <freetype/freetype.h>
@@ -11,14 +18,19 @@
 int FtInit();
 void FtDone();
 
+// FT_Done_Face under the library lock, faces may be closed on any thread
+void FtDoneFace(FT_Face face);
+
 struct FT_FaceDeleter {
   void operator()(FT_Face face) {
-    FT_Done_Face(face);
+    FtDoneFace(face);
   }
 };
 using FT_FacePtr = std::unique_ptr<FT_FaceRec, FT_FaceDeleter>;
 
 struct Font {
+  // font file bytes shared by all faces of the same path, must outlive face
+  std::shared_ptr<const MappedFile> file;
   FT_FacePtr face;
 
   std::string path;
@@ -26,23 +38,77 @@ struct Font {
   float width;
   float linespace;
   float dpiScale;
+  // glyphs are rendered as signed distance fields
+  bool sdf = false;
+  // cell width isn't whole pixels, only if the guifont width asks for it
+  bool fractionalWidth = false;
+  // face has color glyphs (CBDT, sbix, COLR), these go to the atlas color page
+  bool color = false;
+  // bitmap only faces are loaded at the closest strike and scaled by this
+  float strikeScale = 1;
 
   glm::vec2 charSize;
   float ascender;
   float underlinePosition;
   float underlineThickness;
 
-  // index is FT glyph index, not charcode
+  // glyphs are rasterized at this many x offsets within a pixel, so that glyphs in
+  // cells that don't start on a pixel boundary are positioned correctly
+  static constexpr int subpixelBuckets = 4;
+
+  // key is FT glyph index * subpixelBuckets + subpixel, not charcode
   using GlyphInfoMap = std::unordered_map<FT_UInt, GlyphInfo>;
   GlyphInfoMap glyphInfoMap;
 
+  // rasterized bitmaps persisted across launches and size changes
+  GlyphCache glyphCache;
+
+  // coverage bitmaps rasterized by Rasterize, not yet in the atlas
+  struct PendingGlyph {
+    int32_t left;
+    int32_t top;
+    uint32_t width;
+    uint32_t rows;
+    std::vector<uint8_t> bitmap;
+  };
+  std::unordered_map<FT_UInt, PendingGlyph> pendingGlyphs;
+
   static std::expected<Font, std::string>
   FromName(const FontDescriptorWithName& desc, float linespace, float dpiScale);
 
   Font() = default;
-  Font(std::string path, float height, float width, float linespace, float dpiScale);
+  Font(
+    std::string path,
+    float height,
+    float width,
+    float linespace,
+    float dpiScale,
+    bool sdf = false
+  );
 
   // returns nullptr when charcode is not found.
   // updates glyphInfoMap when charcode not in map.
-  const GlyphInfo* GetGlyphInfo(char32_t charcode, TextureAtlas& textureAtlas);
+  // subpixel is the x offset in 1/subpixelBuckets of a pixel, ignored for sdf.
+  const GlyphInfo*
+  GetGlyphInfo(char32_t charcode, TextureAtlas& textureAtlas, int subpixel = 0);
+
+  // rasterizes glyphs into pendingGlyphs without touching the atlas, so that
+  // different fonts can be rasterized on different threads.
+  // GetGlyphInfo adds them to the atlas on first use.
+  void Rasterize(std::span<const char32_t> charcodes, std::span<const int> subpixels);
+
+private:
+  // loads and renders the glyph into face->glyph, offset by subpixel
+  FT_GlyphSlot RenderGlyph(FT_UInt glyphIndex, int subpixel);
+  // adds a coverage bitmap to the atlas and glyphInfoMap
+  const GlyphInfo* AddGlyph(
+    FT_UInt variantKey,
+    int left,
+    int top,
+    std::mdspan<const uint8_t, std::dextents<size_t, 2>> bitmap,
+    TextureAtlas& textureAtlas
+  );
+  // scales the bgra bitmap in the glyph slot and adds it to the color page.
+  // not stored in glyphCache, which only holds coverage bitmaps.
+  const GlyphInfo* AddColorGlyph(FT_UInt variantKey, TextureAtlas& textureAtlas);
 };
@@ -0,0 +1,151 @@
+#include "locator.hpp"
+#include "app/path.hpp"
+#include "utils/logger.hpp"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+#include <fontconfig/fontconfig.h>
+
+namespace fs = std::filesystem;
+
+// name + style -> path, resolved through fontconfig once and persisted in
+// cacheDir/font_index so startup and zoom don't rescan.
+// index file is one "name\tbold\titalic\tpath" entry per line.
+namespace {
+struct FontIndex {
+  using Key = std::tuple<std::string, bool, bool>;
+  std::map<Key, std::string> paths;
+  std::mutex mutex;
+  bool loaded = false;
+
+  fs::path FilePath() const {
+    if (cacheDir.empty()) return {};
+    return fs::path(cacheDir) / "font_index";
+  }
+
+  void Load() {
+    loaded = true;
+    auto filePath = FilePath();
+    if (filePath.empty()) return;
+
+    std::ifstream file(filePath);
+    std::string version;
+    // fontconfig version change may change matching, rebuild the index
+    if (!std::getline(file, version) || version != std::to_string(FcGetVersion())) {
+      return;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+      std::istringstream iss(line);
+      std::string name, bold, italic, path;
+      if (!std::getline(iss, name, '\t') || !std::getline(iss, bold, '\t') ||
+          !std::getline(iss, italic, '\t') || !std::getline(iss, path)) {
+        continue;
+      }
+      // font may have been uninstalled
+      std::error_code ec;
+      if (!fs::exists(path, ec)) continue;
+      paths[{name, bold == "1", italic == "1"}] = path;
+    }
+  }
+
+  void Save() const {
+    auto filePath = FilePath();
+    if (filePath.empty()) return;
+
+    std::error_code ec;
+    fs::create_directories(filePath.parent_path(), ec);
+    auto tmpPath = filePath;
+    tmpPath += ".tmp";
+    {
+      std::ofstream file(tmpPath, std::ios::trunc);
+      if (!file) return;
+      file << FcGetVersion() << '\n';
+      for (const auto& [key, path] : paths) {
+        if (path.empty()) continue;
+        const auto& [name, bold, italic] = key;
+        file << name << '\t' << bold << '\t' << italic << '\t' << path << '\n';
+      }
+    }
+    fs::rename(tmpPath, filePath, ec);
+    if (ec) {
+      LOG_WARN("Failed to write font index: {}", ec.message());
+    }
+  }
+};
+} // namespace
+
+static FontIndex fontIndex;
+
+// fontconfig always returns a match, reject ones that are substitutes
+static bool MatchesName(FcPattern* match, const std::string& name) {
+  auto nameStr = (const FcChar8*)name.c_str();
+  for (const char* object : {FC_FAMILY, FC_FULLNAME, FC_POSTSCRIPT_NAME}) {
+    FcChar8* value;
+    for (int i = 0; FcPatternGetString(match, object, i, &value) == FcResultMatch;
+         i++) {
+      if (FcStrCmpIgnoreCase(value, nameStr) == 0) return true;
+    }
+  }
+  return false;
+}
+
+static std::string FcFindPath(const FontDescriptorWithName& desc) {
+  static std::once_flag initFlag;
+  std::call_once(initFlag, [] {
+    if (!FcInit()) LOG_ERR("Failed to initialize fontconfig");
+  });
+
+  FcPattern* pattern = FcPatternCreate();
+  FcPatternAddString(pattern, FC_FAMILY, (const FcChar8*)desc.name.c_str());
+  FcPatternAddInteger(
+    pattern, FC_WEIGHT, desc.bold ? FC_WEIGHT_BOLD : FC_WEIGHT_REGULAR
+  );
+  FcPatternAddInteger(
+    pattern, FC_SLANT, desc.italic ? FC_SLANT_ITALIC : FC_SLANT_ROMAN
+  );
+  FcConfigSubstitute(nullptr, pattern, FcMatchPattern);
+  FcDefaultSubstitute(pattern);
+
+  FcResult result;
+  FcPattern* match = FcFontMatch(nullptr, pattern, &result);
+  FcPatternDestroy(pattern);
+  if (match == nullptr) return "";
+
+  std::string path;
+  FcChar8* file;
+  if (MatchesName(match, desc.name) &&
+      FcPatternGetString(match, FC_FILE, 0, &file) == FcResultMatch) {
+    path = (const char*)file;
+  }
+  FcPatternDestroy(match);
+
+  return path;
+}
+
+std::string GetFontPathFromName(const FontDescriptorWithName& desc) {
+  FontIndex::Key key{desc.name, desc.bold, desc.italic};
+  {
+    std::lock_guard lock(fontIndex.mutex);
+    if (!fontIndex.loaded) fontIndex.Load();
+    if (auto it = fontIndex.paths.find(key); it != fontIndex.paths.end()) {
+      return it->second;
+    }
+  }
+
+  // not locked, lookups of other fonts run in parallel. fontconfig is thread safe
+  // after FcInit
+  auto path = FcFindPath(desc);
+
+  std::lock_guard lock(fontIndex.mutex);
+  // not found is only cached in process, the font may be installed later
+  auto [it, inserted] = fontIndex.paths.emplace(key, path);
+  if (inserted && !path.empty()) fontIndex.Save();
+  return it->second;
+}
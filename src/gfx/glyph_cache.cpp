@@ -0,0 +1,434 @@
+#include "glyph_cache.hpp"
+#include "app/path.hpp"
+#include "utils/logger.hpp"
+#include "SDL3/SDL_platform_defines.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <random>
+#include <unordered_set>
+#include <utility>
+
+#if defined(SDL_PLATFORM_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static constexpr char magic[8] = {'N', 'G', 'G', 'L', 'Y', 'P', 'H', '\0'};
+
+static uint64_t
+Fnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+static bool KeyEqual(const GlyphCache::Key& a, const GlyphCache::Key& b) {
+  return a.fontHash == b.fontHash && a.pixelWidth == b.pixelWidth &&
+         a.pixelHeight == b.pixelHeight && a.dpiScale == b.dpiScale &&
+         a.loadFlags == b.loadFlags && a.renderMode == b.renderMode;
+}
+
+static uint64_t HashKey(const GlyphCache::Key& key) {
+  uint64_t hash = Fnv1a(&key.fontHash, sizeof(key.fontHash));
+  hash = Fnv1a(&key.pixelWidth, sizeof(key.pixelWidth), hash);
+  hash = Fnv1a(&key.pixelHeight, sizeof(key.pixelHeight), hash);
+  hash = Fnv1a(&key.dpiScale, sizeof(key.dpiScale), hash);
+  hash = Fnv1a(&key.loadFlags, sizeof(key.loadFlags), hash);
+  hash = Fnv1a(&key.renderMode, sizeof(key.renderMode), hash);
+  return hash;
+}
+
+uint64_t GlyphCache::HashFontFile(const std::string& fontPath) {
+  std::error_code ec;
+  auto fileSize = fs::file_size(fontPath, ec);
+  if (ec) fileSize = 0;
+  auto writeTime = fs::last_write_time(fontPath, ec);
+  int64_t ticks = ec ? 0 : writeTime.time_since_epoch().count();
+
+  uint64_t hash = Fnv1a(fontPath.data(), fontPath.size());
+  hash = Fnv1a(&fileSize, sizeof(fileSize), hash);
+  hash = Fnv1a(&ticks, sizeof(ticks), hash);
+  return hash;
+}
+
+GlyphCache::GlyphCache(const Key& _key) : key(_key) {
+  if (cacheDir.empty()) return;
+  path = (fs::path(cacheDir) / "glyphs" / std::format("{:016x}.bin", HashKey(key)))
+           .string();
+
+  Load();
+}
+
+// validated view into a mapped cache file
+struct CacheView {
+  const GlyphCache::Entry* entries = nullptr;
+  const uint8_t* bitmapData = nullptr;
+  uint32_t numEntries = 0;
+  size_t dataSize = 0;
+};
+
+static std::optional<CacheView>
+ParseCacheFile(const MappedFile& file, const GlyphCache::Key& key) {
+  if (!file || file.size < sizeof(GlyphCache::Header)) return std::nullopt;
+
+  auto* header = reinterpret_cast<const GlyphCache::Header*>(file.data);
+  if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 ||
+      header->version != GlyphCache::version || !KeyEqual(header->key, key)) {
+    return std::nullopt;
+  }
+
+  size_t dataStart =
+    sizeof(GlyphCache::Header) + header->numEntries * sizeof(GlyphCache::Entry);
+  if (file.size < dataStart) return std::nullopt;
+
+  return CacheView{
+    .entries = reinterpret_cast<const GlyphCache::Entry*>(
+      file.data + sizeof(GlyphCache::Header)
+    ),
+    .bitmapData = file.data + dataStart,
+    .numEntries = header->numEntries,
+    .dataSize = file.size - dataStart,
+  };
+}
+
+static bool EntryInBounds(const GlyphCache::Entry& entry, size_t dataSize) {
+  return size_t(entry.dataOffset) + size_t(entry.width) * entry.rows <= dataSize;
+}
+
+void GlyphCache::Load() {
+  entries = nullptr;
+  bitmapData = nullptr;
+  numEntries = 0;
+  indexed = false;
+  index.clear();
+
+  // a mismatch just means the cache is rebuilt on the next flush
+  file = MappedFile(path);
+  auto view = ParseCacheFile(file, key);
+  if (!view) {
+    file = {};
+    return;
+  }
+
+  numEntries = view->numEntries;
+  entries = view->entries;
+  bitmapData = view->bitmapData;
+
+  // mtime marks the file as recently used for Prune
+  std::error_code ec;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+}
+
+GlyphCache::~GlyphCache() {
+  Flush();
+}
+
+GlyphCache& GlyphCache::operator=(GlyphCache&& other) {
+  if (this != &other) {
+    Flush();
+    path = std::move(other.path);
+    key = other.key;
+    file = std::move(other.file);
+    entries = std::exchange(other.entries, nullptr);
+    bitmapData = std::exchange(other.bitmapData, nullptr);
+    numEntries = std::exchange(other.numEntries, 0);
+    indexed = std::exchange(other.indexed, false);
+    index = std::move(other.index);
+    pendingEntries = std::move(other.pendingEntries);
+    pendingData = std::move(other.pendingData);
+    other.index.clear();
+    other.pendingEntries.clear();
+    other.pendingData.clear();
+  }
+  return *this;
+}
+
+std::optional<GlyphCache::Glyph> GlyphCache::Find(uint32_t glyphIndex) {
+  if (!file) return std::nullopt;
+
+  if (!indexed) {
+    size_t dataSize = file.size - (bitmapData - file.data);
+    for (uint32_t i = 0; i < numEntries; i++) {
+      const auto& entry = entries[i];
+      // skip entries pointing outside of the file (truncated write)
+      if (!EntryInBounds(entry, dataSize)) continue;
+      index.emplace(entry.glyphIndex, &entry);
+    }
+    indexed = true;
+  }
+
+  auto it = index.find(glyphIndex);
+  if (it == index.end()) return std::nullopt;
+
+  const Entry* entry = it->second;
+  return Glyph{
+    .entry = entry,
+    .bitmap = std::mdspan(bitmapData + entry->dataOffset, entry->rows, entry->width),
+  };
+}
+
+void GlyphCache::Add(
+  uint32_t glyphIndex,
+  int32_t left,
+  int32_t top,
+  uint32_t width,
+  uint32_t rows,
+  int pitch,
+  const uint8_t* buffer
+) {
+  if (path.empty()) return;
+
+  pendingEntries.push_back(Entry{
+    .glyphIndex = glyphIndex,
+    .left = left,
+    .top = top,
+    .width = width,
+    .rows = rows,
+    .dataOffset = uint32_t(pendingData.size()),
+  });
+  for (uint32_t row = 0; row < rows; row++) {
+    const uint8_t* src = buffer + ptrdiff_t(row) * pitch;
+    pendingData.insert(pendingData.end(), src, src + width);
+  }
+}
+
+// serializes flushes of the same cache file between processes and threads
+#if defined(SDL_PLATFORM_WIN32)
+struct FileLock {
+  HANDLE handle = INVALID_HANDLE_VALUE;
+
+  FileLock(const std::string& lockPath) {
+    handle = CreateFileA(
+      lockPath.c_str(), GENERIC_READ | GENERIC_WRITE,
+      FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS,
+      FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    OVERLAPPED overlapped{};
+    DWORD flags = LOCKFILE_EXCLUSIVE_LOCK;
+    if (handle != INVALID_HANDLE_VALUE &&
+        !LockFileEx(handle, flags, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+      CloseHandle(handle);
+      handle = INVALID_HANDLE_VALUE;
+    }
+  }
+  ~FileLock() {
+    // closing the handle releases the lock
+    if (handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+  }
+  FileLock(const FileLock&) = delete;
+  FileLock& operator=(const FileLock&) = delete;
+
+  explicit operator bool() const {
+    return handle != INVALID_HANDLE_VALUE;
+  }
+};
+#else
+struct FileLock {
+  int fd = -1;
+
+  FileLock(const std::string& lockPath) {
+    fd = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd >= 0 && flock(fd, LOCK_EX) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  ~FileLock() {
+    if (fd >= 0) close(fd);
+  }
+  FileLock(const FileLock&) = delete;
+  FileLock& operator=(const FileLock&) = delete;
+
+  explicit operator bool() const {
+    return fd >= 0;
+  }
+};
+#endif
+
+// flushes run on background threads and may outlive the cache that started them
+static std::mutex flushMutex;
+static std::vector<std::future<void>> flushTasks;
+
+// merges entries with the file on disk and replaces it
+static void WriteCacheFile(
+  const std::string& path,
+  const GlyphCache::Key& key,
+  const std::vector<GlyphCache::Entry>& pendingEntries,
+  const std::vector<uint8_t>& pendingData
+) {
+  using Entry = GlyphCache::Entry;
+  using Header = GlyphCache::Header;
+
+  std::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+
+  // another process may have replaced the file since it was loaded, so merge
+  // with what is on disk now, under the lock, instead of with our own mapping
+  FileLock lock(path + ".lock");
+  if (!lock) {
+    LOG_WARN("GlyphCache: failed to lock {}", path);
+    return;
+  }
+
+  MappedFile current(path);
+  auto view = ParseCacheFile(current, key);
+
+  std::vector<Entry> allEntries;
+  std::unordered_set<uint32_t> glyphIndices;
+  size_t oldDataSize = 0;
+  if (view) {
+    // past the size bound the old glyphs are evicted, and only what this
+    // process rasterized is kept
+    size_t oldSize = sizeof(Header) + view->numEntries * sizeof(Entry) +
+                     view->dataSize;
+    if (oldSize + pendingData.size() <= GlyphCache::maxFileSize) {
+      oldDataSize = view->dataSize;
+      allEntries.reserve(view->numEntries + pendingEntries.size());
+      for (uint32_t i = 0; i < view->numEntries; i++) {
+        const auto& entry = view->entries[i];
+        if (!EntryInBounds(entry, oldDataSize)) continue;
+        if (!glyphIndices.insert(entry.glyphIndex).second) continue;
+        allEntries.push_back(entry);
+      }
+    }
+  }
+
+  // glyphs another process already wrote are dropped from pending
+  std::vector<uint8_t> newData;
+  newData.reserve(pendingData.size());
+  size_t numNewEntries = 0;
+  for (auto entry : pendingEntries) {
+    if (!glyphIndices.insert(entry.glyphIndex).second) continue;
+    numNewEntries++;
+    size_t size = size_t(entry.width) * entry.rows;
+    const uint8_t* src = pendingData.data() + entry.dataOffset;
+    entry.dataOffset = oldDataSize + newData.size();
+    newData.insert(newData.end(), src, src + size);
+    allEntries.push_back(entry);
+  }
+  if (numNewEntries == 0) return;
+
+  Header header{};
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = GlyphCache::version;
+  header.numEntries = allEntries.size();
+  header.key = key;
+
+  // write to a temporary file and rename, so readers never see a partial file.
+  // the name is random so concurrent writers never share a temporary file
+  static thread_local std::mt19937_64 rng(std::random_device{}());
+  auto tmpPath = std::format("{}.{:016x}.tmp", path, rng());
+  {
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      LOG_WARN("GlyphCache: failed to write {}", tmpPath);
+      return;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(
+      reinterpret_cast<const char*>(allEntries.data()),
+      allEntries.size() * sizeof(Entry)
+    );
+    if (oldDataSize > 0) {
+      out.write(reinterpret_cast<const char*>(view->bitmapData), oldDataSize);
+    }
+    out.write(reinterpret_cast<const char*>(newData.data()), newData.size());
+  }
+  // unmap before replacing, windows can't replace a file mapped by this process
+  current = {};
+  fs::rename(tmpPath, path, ec);
+
+  if (ec) {
+    LOG_WARN("GlyphCache: failed to replace {}: {}", path, ec.message());
+    fs::remove(tmpPath, ec);
+  }
+}
+
+void GlyphCache::Flush() {
+  if (pendingEntries.empty()) return;
+
+  // runs whenever a font is evicted from the size cache, which happens on the
+  // render thread while zooming, so the disk work is done in the background
+  auto task = std::async(
+    std::launch::async,
+    [path = path, key = key, entries = std::move(pendingEntries),
+     data = std::move(pendingData)] {
+      WriteCacheFile(path, key, entries, data);
+      Prune();
+    }
+  );
+  pendingEntries.clear();
+  pendingData.clear();
+
+  std::lock_guard lock(flushMutex);
+  std::erase_if(flushTasks, [](const std::future<void>& flushTask) {
+    return flushTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  });
+  flushTasks.push_back(std::move(task));
+}
+
+void GlyphCache::WaitForFlushes() {
+  std::vector<std::future<void>> tasks;
+  {
+    std::lock_guard lock(flushMutex);
+    tasks = std::move(flushTasks);
+    flushTasks.clear();
+  }
+  for (auto& task : tasks) task.wait();
+}
+
+void GlyphCache::Prune() {
+  if (cacheDir.empty()) return;
+  auto dir = fs::path(cacheDir) / "glyphs";
+
+  struct CacheFile {
+    fs::path path;
+    uintmax_t size;
+    fs::file_time_type writeTime;
+  };
+  std::vector<CacheFile> files;
+  uintmax_t totalSize = 0;
+
+  std::error_code ec;
+  auto staleTime = fs::file_time_type::clock::now() - std::chrono::hours(1);
+  for (const auto& dirEntry : fs::directory_iterator(dir, ec)) {
+    auto filePath = dirEntry.path();
+    auto writeTime = dirEntry.last_write_time(ec);
+    if (ec) continue;
+    auto ext = filePath.extension();
+    // temporary files left behind by a crashed writer
+    if (ext == ".tmp") {
+      if (writeTime < staleTime) fs::remove(filePath, ec);
+      continue;
+    }
+    if (ext != ".bin") continue;
+    auto size = dirEntry.file_size(ec);
+    if (ec) continue;
+    files.push_back({filePath, size, writeTime});
+    totalSize += size;
+  }
+  if (totalSize <= maxTotalSize) return;
+
+  // least recently used first
+  std::ranges::sort(files, {}, &CacheFile::writeTime);
+  for (const auto& cacheFile : files) {
+    if (totalSize <= maxTotalSize) break;
+    // lock files are kept, removing one could let two writers lock different files
+    if (fs::remove(cacheFile.path, ec)) totalSize -= cacheFile.size;
+  }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "utils/mapped_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <mdspan>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Persistent on-disk cache of rasterized glyphs for a single face at a single size.
+// The cache file is memory mapped and only indexed on the first lookup.
+// Newly rasterized glyphs are kept in memory and written back on a background
+// thread when the cache is destroyed.
+struct GlyphCache {
+  static constexpr uint32_t version = 2;
+  // a file past this size is rebuilt from the glyphs of the current process
+  static constexpr size_t maxFileSize = 8 << 20;
+  // least recently used files are removed past this total size
+  static constexpr uintmax_t maxTotalSize = 128 << 20;
+
+  // everything that changes the rasterized output
+  struct Key {
+    uint64_t fontHash;
+    uint32_t pixelWidth; // 26.6 fixed point
+    uint32_t pixelHeight;
+    float dpiScale;
+    int32_t loadFlags;
+    int32_t renderMode;
+  };
+
+  // file layout: Header, Entry[numEntries], bitmap data
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t numEntries;
+    Key key;
+  };
+
+  struct Entry {
+    uint32_t glyphIndex; // glyph variant, see Font::GlyphInfoMap
+    int32_t left; // FT bitmap_left
+    int32_t top;  // FT bitmap_top
+    uint32_t width;
+    uint32_t rows;
+    uint32_t dataOffset; // relative to start of bitmap data
+  };
+
+  struct Glyph {
+    const Entry* entry;
+    std::mdspan<const uint8_t, std::dextents<size_t, 2>> bitmap;
+  };
+
+  std::string path;
+  Key key{};
+
+  MappedFile file;
+  const Entry* entries = nullptr;
+  const uint8_t* bitmapData = nullptr;
+  uint32_t numEntries = 0;
+
+  bool indexed = false;
+  std::unordered_map<uint32_t, const Entry*> index;
+
+  // glyphs not yet in the cache file
+  std::vector<Entry> pendingEntries;
+  std::vector<uint8_t> pendingData;
+
+  // identifies a font file by path, size and modification time
+  static uint64_t HashFontFile(const std::string& fontPath);
+
+  GlyphCache() = default;
+  GlyphCache(const Key& key);
+  ~GlyphCache();
+
+  GlyphCache(const GlyphCache&) = delete;
+  GlyphCache& operator=(const GlyphCache&) = delete;
+  GlyphCache(GlyphCache&&) = default;
+  GlyphCache& operator=(GlyphCache&& other);
+
+  // returns nullopt if the glyph isn't in the cache file
+  std::optional<Glyph> Find(uint32_t glyphIndex);
+
+  // bitmap rows are pitch bytes apart, only width bytes of each row are stored
+  void Add(
+    uint32_t glyphIndex,
+    int32_t left,
+    int32_t top,
+    uint32_t width,
+    uint32_t rows,
+    int pitch,
+    const uint8_t* buffer
+  );
+
+  // hands pending glyphs to a background task, which merges them with the file on
+  // disk and replaces it. the cache keeps using its current mapping.
+  void Flush();
+  // blocks until all background flushes are done, call before exiting
+  static void WaitForFlushes();
+
+  // removes least recently used cache files past maxTotalSize
+  static void Prune();
+
+private:
+  // maps and validates the cache file, leaves the cache empty on mismatch
+  void Load();
+};
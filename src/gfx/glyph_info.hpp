@@ -5,5 +5,6 @@ struct GlyphInfo {
   Region localPoss;   // relative position to ascender (aside from box drawing)
   Region atlasRegion; // position in texture atlas
   bool boxDrawing = false;
+  bool color = false; // premultiplied rgba in TextureAtlas::colorPage
 };
 
@@ -2,9 +2,16 @@
 #include "utils/logger.hpp"
 #include "utils/variant.hpp"
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace box {
 
 static float fpart(float x) {
@@ -42,6 +49,35 @@ void Pen::Fill(int x, int y, uint8_t alpha) {
   canvas[y, x] = std::min(canvas[y, x] + alpha, 255);
 }
 
+// dst[i] = min(dst[i] + src[i], 255)
+static void AddSaturate(uint8_t* dst, const uint8_t* src, size_t size) {
+  // sse2 is baseline on x86-64 and neon on arm64. spans are a cell wide, so wider
+  // vectors would mostly run the scalar tail
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= size; i += 16) {
+    auto a = _mm_loadu_si128((const __m128i*)(dst + i));
+    auto b = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_adds_epu8(a, b));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 16 <= size; i += 16) {
+    vst1q_u8(dst + i, vqaddq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+  }
+#endif
+  for (; i < size; i++) {
+    dst[i] = std::min(dst[i] + src[i], 255);
+  }
+}
+
+// coverage of pixel [p, p + 1) by [start, end)
+static float Coverage(int p, float start, float end) {
+  if (p < start && p > end - 1) return end - start;
+  if (p < start) return rfpart(start);
+  if (p > end - 1) return fpart(end);
+  return 1;
+}
+
 void Pen::DrawRect(float left, float top, float width, float height) {
   assert(left >= 0 && top >= 0);
   assert(width > 0 && height > 0);
@@ -50,27 +86,37 @@ void Pen::DrawRect(float left, float top, float width, float height) {
   float bottom = top + height;
   assert(right <= xsize && bottom <= ysize);
 
-  for (int y = top; y < bottom; y++) {
-    for (int x = left; x < right; x++) {
-      float alpha = 1;
-
-      if (x < left && x > right - 1) {
-        alpha *= right - left;
-      } else if (x < left) {
-        alpha *= rfpart(left);
-      } else if (x > right - 1) {
-        alpha *= fpart(right);
-      }
+  // coverage is separable, so compute the column coverage once and fill
+  // each row as a span scaled by the row coverage.
+  // only the first and last rows are partially covered.
+  int xstart = left;
+  int xend = std::min<int>(std::ceil(right), canvas.extent(1));
+  int ystart = top;
+  int yend = std::min<int>(std::ceil(bottom), canvas.extent(0));
+  if (xstart >= xend || ystart >= yend) return;
+
+  // wider rects are filled in chunks of maxSpanSize columns
+  std::array<float, maxSpanSize> colAlpha;
+  std::array<uint8_t, maxSpanSize> span;
+  std::array<uint8_t, maxSpanSize> fullSpan;
+  for (int chunkStart = xstart; chunkStart < xend; chunkStart += maxSpanSize) {
+    size_t spanSize = std::min<size_t>(xend - chunkStart, maxSpanSize);
+
+    for (size_t i = 0; i < spanSize; i++) {
+      colAlpha[i] = Coverage(chunkStart + i, left, right);
+      fullSpan[i] = colAlpha[i] * 255;
+    }
 
-      if (y < top && y > bottom - 1) {
-        alpha *= bottom - top;
-      } else if (y < top) {
-        alpha *= rfpart(top);
-      } else if (y > bottom - 1) {
-        alpha *= fpart(bottom);
+    for (int y = ystart; y < yend; y++) {
+      float rowAlpha = Coverage(y, top, bottom);
+      const uint8_t* src = fullSpan.data();
+      if (rowAlpha != 1) {
+        for (size_t i = 0; i < spanSize; i++) {
+          span[i] = colAlpha[i] * rowAlpha * 255;
+        }
+        src = span.data();
       }
-
-      Fill(x, y, alpha * 255);
+      AddSaturate(&canvas[y, chunkStart], src, spanSize);
     }
   }
 }
@@ -93,6 +139,39 @@ void Pen::DrawVLine(float xpos, float start, float end, float lineWidth) {
   DrawRect(left, top, lineWidth, end - start);
 }
 
+void Pen::DrawCircle(float _xcenter, float _ycenter, float radius) {
+  // anti-aliased edge, same falloff as the old shapes shader circle
+  float fade = std::min(radius * 0.1f, 1.0f);
+  auto smoothstep = [](float edge0, float edge1, float x) {
+    float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+    return t * t * (3 - 2 * t);
+  };
+
+  int xstart = std::max<int>(std::floor(_xcenter - radius), 0);
+  int xend = std::min<int>(std::ceil(_xcenter + radius), canvas.extent(1));
+  int ystart = std::max<int>(std::floor(_ycenter - radius), 0);
+  int yend = std::min<int>(std::ceil(_ycenter + radius), canvas.extent(0));
+
+  // compare squared distances, only the anti-aliased edge needs the sqrt
+  float inner = radius - fade;
+  float innerSq = inner * inner;
+  float radiusSq = radius * radius;
+  for (int y = ystart; y < yend; y++) {
+    float dy = y + 0.5f - _ycenter;
+    for (int x = xstart; x < xend; x++) {
+      float dx = x + 0.5f - _xcenter;
+      float distSq = dx * dx + dy * dy;
+      if (distSq >= radiusSq) continue;
+      if (distSq <= innerSq) {
+        Fill(x, y, 255);
+        continue;
+      }
+      float alpha = 1 - smoothstep(inner, radius, std::sqrt(distSq));
+      if (alpha > 0) Fill(x, y, alpha * 255);
+    }
+  }
+}
+
 void Pen::DrawHLine(float start, float end, Weight weight) {
   assert(weight != None);
   if (weight == Double) {
@@ -291,6 +370,47 @@ void Pen::DrawQuadrant(const Quadrant& desc) {
   }
 }
 
+void Pen::DrawBraille(const Braille& desc) {
+  // dot number, bit
+  // 1 4    01 08
+  // 2 5    02 10
+  // 3 6    04 20
+  // 7 8    40 80
+  using Offsets = std::array<std::array<float, 2>, 8>;
+  static constexpr Offsets sixDotOffsets{{
+    {1 / 4., 1 / 6.},
+    {1 / 4., 3 / 6.},
+    {1 / 4., 5 / 6.},
+    {3 / 4., 1 / 6.},
+    {3 / 4., 3 / 6.},
+    {3 / 4., 5 / 6.},
+  }};
+  static constexpr Offsets eightDotOffsets{{
+    {1 / 4., 1 / 8.},
+    {1 / 4., 3 / 8.},
+    {1 / 4., 5 / 8.},
+    {3 / 4., 1 / 8.},
+    {3 / 4., 3 / 8.},
+    {3 / 4., 5 / 8.},
+    {1 / 4., 7 / 8.},
+    {3 / 4., 7 / 8.},
+  }};
+
+  // patterns without dots 7 and 8 are spread over 3 rows
+  bool sixDots = desc.dots < 0x40;
+  const auto& offsets = sixDots ? sixDotOffsets : eightDotOffsets;
+  int numDots = sixDots ? 6 : 8;
+
+  float radius = std::min(xsize / 2, ysize / (numDots / 2)) / 2;
+  radius *= 0.6; // add some padding
+
+  for (int dotIndex = 0; dotIndex < numDots; dotIndex++) {
+    if (!(desc.dots & (1 << dotIndex))) continue;
+    auto [xoffset, yoffset] = offsets[dotIndex];
+    DrawCircle(xoffset * xsize, yoffset * ysize, radius);
+  }
+}
+
 void Pen::Draw(const DrawDesc& desc) {
   std::visit(overloaded{
     [this](const HLine& desc) { DrawHLine(0, xsize, desc.weight); },
@@ -304,7 +424,8 @@ void Pen::Draw(const DrawDesc& desc) {
     [this](const LowerBlock& desc) { DrawRect(0, ysize - (desc.size * ysize), xsize, desc.size * ysize); },
     [this](const LeftBlock& desc) { DrawRect(0, 0, desc.size * xsize, ysize); },
     [this](const RightBlock& desc) { DrawRect(xsize - (desc.size * xsize), 0, desc.size * xsize, ysize); },
-    [this](const Quadrant& desc) { DrawQuadrant(desc); }
+    [this](const Quadrant& desc) { DrawQuadrant(desc); },
+    [this](const Braille& desc) { DrawBraille(desc); }
   }, desc);
 }
 
@@ -1,4 +1,6 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <mdspan>
 #include <variant>
 
@@ -61,6 +63,11 @@ struct Quadrant {
   bool bottomRight = false;
 };
 
+// braille pattern, bit i is dot i + 1
+struct Braille {
+  uint8_t dots;
+};
+
 using DrawDesc = std::variant<
   HLine,
   VLine,
@@ -73,9 +80,13 @@ using DrawDesc = std::variant<
   LowerBlock,
   LeftBlock,
   RightBlock,
-  Quadrant>;
+  Quadrant,
+  Braille>;
 
 struct Pen {
+  // columns of a rect filled at once, wider rects are filled in chunks
+  static constexpr size_t maxSpanSize = 1024;
+
   BufType canvas;
   float xsize;
   float ysize;
@@ -88,9 +99,11 @@ struct Pen {
   float ToWidth(Weight weight);
 
   void Fill(int x, int y, uint8_t alpha);
+  // fills with fractional coverage at the edges, rows are filled as SIMD spans
   void DrawRect(float left, float top, float width, float height);
   void DrawHLine(float ypos, float start, float end, float lineWidth);
   void DrawVLine(float xpos, float start, float end, float lineWidth);
+  void DrawCircle(float xcenter, float ycenter, float radius);
 
   void DrawHLine(float start, float end, Weight weight);
   void DrawVLine(float start, float end, Weight weight);
@@ -100,6 +113,7 @@ struct Pen {
   void DrawDoubleCross(const DoubleCross& desc);
   void DrawHalfLine(const HalfLine& desc);
   void DrawQuadrant(const Quadrant& desc);
+  void DrawBraille(const Braille& desc);
 
   void Draw(const DrawDesc& desc);
 };
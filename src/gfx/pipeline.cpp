@@ -47,6 +47,7 @@ Pipeline::Pipeline(const WGPUContext& ctx) {
           {VertexFormat::Float32x2, offsetof(ShapeQuadVertex, coord)},
           {VertexFormat::Float32x4, offsetof(ShapeQuadVertex, color)},
           {VertexFormat::Uint32, offsetof(ShapeQuadVertex, shapeType)},
+          {VertexFormat::Uint32, offsetof(ShapeQuadVertex, shapeDesc)},
         }
       }
     },
@@ -111,6 +112,68 @@ Pipeline::Pipeline(const WGPUContext& ctx) {
     },
   });
 
+  // sdf glyphs, same layout as text
+  ShaderModule textSdfShader =
+    utils::LoadShaderModule(ctx.device, resourcesDir + "/shaders/text_sdf.wgsl");
+
+  textSdfRPL = utils::MakeRenderPipeline(ctx.device, {
+    .vs = textSdfShader,
+    .fs = textSdfShader,
+    .bgls = {viewProjBGL, gammaBGL, textureSizeBGL, textureBGL},
+    .buffers = {
+      {
+        sizeof(TextQuadVertex),
+        {
+          {VertexFormat::Float32x2, offsetof(TextQuadVertex, position)},
+          {VertexFormat::Float32x2, offsetof(TextQuadVertex, regionCoord)},
+          {VertexFormat::Float32x4, offsetof(TextQuadVertex, foreground)},
+        }
+      }
+    },
+    .targets = {
+      {
+        .format = TextureFormat::RGBA8UnormSrgb,
+        .blend = &utils::BlendState::AlphaBlending,
+      },
+    },
+  });
+
+  // color glyphs, premultiplied alpha
+  ShaderModule colorTextShader =
+    utils::LoadShaderModule(ctx.device, resourcesDir + "/shaders/text_color.wgsl");
+
+  BlendComponent premultipliedBlend{
+    .operation = BlendOperation::Add,
+    .srcFactor = BlendFactor::One,
+    .dstFactor = BlendFactor::OneMinusSrcAlpha,
+  };
+  BlendState premultipliedBlending{
+    .color = premultipliedBlend,
+    .alpha = premultipliedBlend,
+  };
+
+  colorTextRPL = utils::MakeRenderPipeline(ctx.device, {
+    .vs = colorTextShader,
+    .fs = colorTextShader,
+    .bgls = {viewProjBGL, gammaBGL, textureSizeBGL, textureBGL},
+    .buffers = {
+      {
+        sizeof(TextQuadVertex),
+        {
+          {VertexFormat::Float32x2, offsetof(TextQuadVertex, position)},
+          {VertexFormat::Float32x2, offsetof(TextQuadVertex, regionCoord)},
+          {VertexFormat::Float32x4, offsetof(TextQuadVertex, foreground)},
+        }
+      }
+    },
+    .targets = {
+      {
+        .format = TextureFormat::RGBA8UnormSrgb,
+        .blend = &premultipliedBlending,
+      },
+    },
+  });
+
   // mask
   ShaderModule textMaskShader =
     utils::LoadShaderModule(ctx.device, resourcesDir + "/shaders/text_mask.wgsl");
@@ -133,6 +196,33 @@ Pipeline::Pipeline(const WGPUContext& ctx) {
     },
   });
 
+  // shapes into the mask. shapes output (color.rgb, coverage), so white shapes
+  // blended over the cleared mask leave the coverage in the red channel
+  shapesMaskRPL = utils::MakeRenderPipeline(ctx.device, {
+    .vs = shapesShader,
+    .fs = shapesShader,
+    .bgls = {viewProjBGL, gammaBGL},
+    .buffers = {
+      {
+        sizeof(ShapeQuadVertex),
+        {
+          {VertexFormat::Float32x2, offsetof(ShapeQuadVertex, position)},
+          {VertexFormat::Float32x2, offsetof(ShapeQuadVertex, size)},
+          {VertexFormat::Float32x2, offsetof(ShapeQuadVertex, coord)},
+          {VertexFormat::Float32x4, offsetof(ShapeQuadVertex, color)},
+          {VertexFormat::Uint32, offsetof(ShapeQuadVertex, shapeType)},
+          {VertexFormat::Uint32, offsetof(ShapeQuadVertex, shapeDesc)},
+        }
+      }
+    },
+    .targets = {
+      {
+        .format = TextureFormat::R8Unorm,
+        .blend = &utils::BlendState::AlphaBlending,
+      },
+    },
+  });
+
   // texture pipeline ------------------------------------------------
   ShaderModule textureShader =
     utils::LoadShaderModule(ctx.device, resourcesDir + "/shaders/texture.wgsl");
@@ -149,10 +239,18 @@ Pipeline::Pipeline(const WGPUContext& ctx) {
     ctx.device, {{0, ShaderStage::Fragment, BufferBindingType::Uniform}}
   );
 
+  // scroll offset and clip rect of ScrollableRenderTexture
+  scrollBGL = utils::MakeBindGroupLayout(
+    ctx.device,
+    {
+      {0, ShaderStage::Vertex | ShaderStage::Fragment, BufferBindingType::Uniform},
+    }
+  );
+
   textureNoBlendRPL = utils::MakeRenderPipeline(ctx.device, {
     .vs = textureShader,
     .fs = textureShader,
-    .bgls = {viewProjBGL, gammaBGL, defaultColorBGL, textureBGL},
+    .bgls = {viewProjBGL, gammaBGL, defaultColorBGL, textureBGL, scrollBGL},
     .buffers = {textureQuadVBL},
     .targets = {
       {
@@ -173,7 +271,7 @@ Pipeline::Pipeline(const WGPUContext& ctx) {
   textureRPL = utils::MakeRenderPipeline(ctx.device, {
     .vs = textureShader,
     .fs = textureShader,
-    .bgls = {viewProjBGL, gammaBGL, defaultColorBGL, textureBGL},
+    .bgls = {viewProjBGL, gammaBGL, defaultColorBGL, textureBGL, scrollBGL},
     .buffers = {textureQuadVBL},
     .targets = {
       {
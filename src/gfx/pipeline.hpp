@@ -17,13 +17,14 @@ struct TextQuadVertex {
   glm::vec4 foreground;
 };
 
-// underlines, braille, box drawing
+// underlines, box drawing (gpu mode)
 struct ShapeQuadVertex {
   glm::vec2 position;
   glm::vec2 size;
   glm::vec2 coord;
   glm::vec4 color;
   uint32_t shapeType;
+  uint32_t shapeDesc; // shape specific params, see BoxDrawing::GpuDesc
 };
 
 struct TextMaskQuadVertex {
@@ -53,9 +54,15 @@ struct Pipeline {
 
   wgpu::BindGroupLayout textureSizeBGL;
   wgpu::RenderPipeline textRPL;
+  // sdf glyph atlas, see FontFamily::sdf
+  wgpu::RenderPipeline textSdfRPL;
+  wgpu::RenderPipeline colorTextRPL;
   wgpu::RenderPipeline textMaskRPL;
+  // shapes drawn into the cursor mask, see Renderer::RenderCursorMask
+  wgpu::RenderPipeline shapesMaskRPL;
 
   wgpu::BindGroupLayout defaultColorBGL;
+  wgpu::BindGroupLayout scrollBGL;
   wgpu::RenderPipeline textureNoBlendRPL;
   wgpu::RenderPipeline textureRPL;
 
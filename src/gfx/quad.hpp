@@ -117,9 +117,9 @@ struct QuadRenderData {
     );
   }
 
-  void Render(
-    const wgpu::RenderPassEncoder& passEncoder, uint64_t offset = 0, uint64_t size = 0
-  ) const {
+  // encoder is a render pass or render bundle encoder
+  template <typename Encoder>
+  void Render(const Encoder& passEncoder, uint64_t offset = 0, uint64_t size = 0) const {
     assert(offset <= quadCount);
     assert(size <= quadCount);
     if (size == 0) size = quadCount;
@@ -6,14 +6,15 @@
 #include "glm/common.hpp"
 #include "utils/line.hpp"
 #include "utils/easing_funcs.hpp"
+#include <algorithm>
 #include <memory>
 
 using namespace wgpu;
 
 RenderTexture::RenderTexture(
-  glm::vec2 _size, float dpiScale, wgpu::TextureFormat format, const void* data
+  glm::vec2 _size, float _dpiScale, wgpu::TextureFormat format, const void* data
 )
-    : size(_size) {
+    : size(_size), dpiScale(_dpiScale) {
   camera = Ortho2D(size);
 
   auto fbSize = size * dpiScale;
@@ -42,6 +43,24 @@ RenderTexture::RenderTexture(
   UpdatePos({0, 0});
 }
 
+RenderTexture::RenderTexture(glm::vec2 _size, float _dpiScale, TileAtlas::Tile _tile)
+    : size(_size), dpiScale(_dpiScale), tile(std::move(_tile)) {
+  camera = Ortho2D(size);
+
+  texture = tile->page->texture;
+  textureView = tile->page->textureView;
+  textureBG = tile->page->textureBG;
+
+  renderData.CreateBuffers(1);
+  UpdatePos({0, 0});
+}
+
+void RenderTexture::SetViewport(const wgpu::RenderPassEncoder& passEncoder) const {
+  if (!tile) return;
+  passEncoder.SetViewport(tile->pos.x, tile->pos.y, tile->size.x, tile->size.y, 0, 1);
+  passEncoder.SetScissorRect(tile->pos.x, tile->pos.y, tile->size.x, tile->size.y);
+}
+
 void RenderTexture::UpdatePos(glm::vec2 pos, std::optional<Rect> region) {
   renderData.ResetCounts();
 
@@ -57,6 +76,13 @@ void RenderTexture::UpdatePos(glm::vec2 pos, std::optional<Rect> region) {
     uvs = region->Region();
   }
 
+  if (tile) {
+    auto pageSize = glm::vec2(TileAtlas::pageSize);
+    for (auto& uv : uvs) {
+      uv = (glm::vec2(tile->pos) + uv * glm::vec2(tile->size)) / pageSize;
+    }
+  }
+
   auto& quad = renderData.NextQuad();
   for (size_t i = 0; i < 4; i++) {
     quad[i].position = positions[i];
@@ -66,14 +92,92 @@ void RenderTexture::UpdatePos(glm::vec2 pos, std::optional<Rect> region) {
 }
 
 void RenderTexture::UpdateCameraPos(glm::vec2 pos) {
+  cameraPos = pos;
   camera.Resize(size, pos);
 }
 
 // ------------------------------------------------------------------
+void RenderTexturePool::Releaser::operator()(RenderTexture* texture) const {
+  renderTexturePool.Release(RenderTextureHandle(texture));
+}
+
+RenderTexturePool::Handle RenderTexturePool::Acquire(
+  glm::vec2 size, float dpiScale, wgpu::TextureFormat format
+) {
+  Key key{size.x, size.y, dpiScale, format};
+  auto it = std::ranges::find_if(entries, [&](const Entry& entry) {
+    return entry.key == key;
+  });
+
+  if (it == entries.end()) {
+    // a new texture is about to be allocated, make room for it
+    stats.misses++;
+    Trim();
+    auto fbSize = glm::uvec2(size * dpiScale);
+    if (auto tile = tileAtlas.Allocate(fbSize, format)) {
+      return Handle(new RenderTexture(size, dpiScale, std::move(*tile)));
+    }
+    return Handle(new RenderTexture(size, dpiScale, format));
+  }
+
+  stats.hits++;
+  pooledBytes -= it->bytes;
+  Handle texture(it->texture.release());
+  entries.erase(it);
+  return texture;
+}
+
+void RenderTexturePool::Release(RenderTextureHandle texture) {
+  if (texture == nullptr || !texture->texture) return;
+
+  // all pooled formats are 4 bytes per texel
+  auto fbSize = glm::uvec2(texture->size * texture->dpiScale);
+  size_t bytes = size_t(fbSize.x) * fbSize.y * 4;
+  entries.push_front(Entry{
+    .key = {
+      texture->size.x, texture->size.y, texture->dpiScale,
+      texture->texture.GetFormat()
+    },
+    .bytes = bytes,
+    .texture = std::move(texture),
+  });
+  pooledBytes += bytes;
+  Trim();
+}
+
+void RenderTexturePool::SetBudget(size_t bytes) {
+  budget = bytes;
+  Trim();
+}
+
+void RenderTexturePool::Trim() {
+  while (pooledBytes > budget && !entries.empty()) {
+    pooledBytes -= entries.back().bytes;
+    entries.pop_back();
+    stats.evictions++;
+  }
+}
+
+void RenderTexturePool::Clear() {
+  LOG_INFO(
+    "RenderTexturePool: {} hits, {} misses, {} evictions, {} textures ({} KB) pooled",
+    stats.hits, stats.misses, stats.evictions, entries.size(), pooledBytes >> 10
+  );
+  entries.clear();
+  pooledBytes = 0;
+}
+
+// ------------------------------------------------------------------
+static uint64_t NextDrawVersion() {
+  static uint64_t version = 0;
+  return ++version;
+}
+
 ScrollableRenderTexture::ScrollableRenderTexture(
   glm::vec2 _size, float _dpiScale, glm::vec2 _charSize
 )
-    : posOffset(0), size(_size), dpiScale(_dpiScale), charSize(_charSize) {
+    : posOffset(0), size(_size), dpiScale(_dpiScale), charSize(_charSize),
+      visibleBottom(_size.y), drawVersion(NextDrawVersion()) {
 
   textureHeight = size.y / maxNumTexPerPage;
   rowsPerTexture = glm::ceil(textureHeight / charSize.y);
@@ -83,10 +187,28 @@ ScrollableRenderTexture::ScrollableRenderTexture(
   int numTexPerPage = glm::ceil(size.y / textureHeight);
   auto texSize = glm::vec2(size.x, textureHeight);
   for (int i = 0; i < numTexPerPage; i++) {
-    renderTextures.push_back(std::make_unique<RenderTexture>(texSize, dpiScale, format));
+    renderTextures.push_back(renderTexturePool.Acquire(texSize, dpiScale, format));
   }
 
   clearData.CreateBuffers(1);
+
+  scrollBuffer =
+    utils::CreateUniformBuffer(ctx.device, sizeof(ScrollUniform), &scrollUniform);
+  scrollBG = utils::MakeBindGroup(
+    ctx.device, ctx.pipeline.scrollBGL,
+    {
+      {0, scrollBuffer},
+    }
+  );
+
+  marginScrollBuffer =
+    utils::CreateUniformBuffer(ctx.device, sizeof(ScrollUniform), &scrollUniform);
+  marginScrollBG = utils::MakeBindGroup(
+    ctx.device, ctx.pipeline.scrollBGL,
+    {
+      {0, marginScrollBuffer},
+    }
+  );
 }
 
 // round to prevent floating point errors (very sus but it works)
@@ -97,7 +219,9 @@ float ScrollableRenderTexture::RoundOffset(float offset) const {
 void ScrollableRenderTexture::UpdatePos(glm::vec2 pos) {
   posOffset = pos;
   SetTexturePositions();
+  UpdateScrollUniform();
   SetTextureCameraPositions();
+  UpdateMarginScrollUniform();
 
   if (marginTextures.top != nullptr) {
     marginTextures.top->UpdatePos(posOffset);
@@ -107,7 +231,7 @@ void ScrollableRenderTexture::UpdatePos(glm::vec2 pos) {
   }
 }
 
-void ScrollableRenderTexture::UpdateViewport(float newScrollDist) {
+void ScrollableRenderTexture::UpdateViewport(float newScrollDist, int cachedRows) {
   // in the middle of scrolling, instead scroll from current pos to new pos
   if (scrolling) {
     baseOffset += scrollCurr;
@@ -121,8 +245,12 @@ void ScrollableRenderTexture::UpdateViewport(float newScrollDist) {
   scrolling = true;
   scrollCurr = 0;
   scrollElapsed = 0;
+  cachedRowsAbove = newScrollDist > 0 ? cachedRows : 0;
+  cachedRowsBelow = newScrollDist < 0 ? cachedRows : 0;
 
   AddOrRemoveTextures();
+  SetTexturePositions();
+  UpdateScrollUniform();
   SetTextureCameraPositions();
 }
 
@@ -137,6 +265,8 @@ void ScrollableRenderTexture::UpdateScrolling(float dt) {
     scrollDist = 0;
     scrollCurr = 0;
     scrollElapsed = 0;
+    cachedRowsAbove = 0;
+    cachedRowsBelow = 0;
 
     // AddOrRemoveTextures();
     SetTextureCameraPositions();
@@ -151,7 +281,7 @@ void ScrollableRenderTexture::UpdateScrolling(float dt) {
     scrollCurr = glm::sign(scrollDist) * glm::mix(0.0f, glm::abs(scrollDist), y);
   }
 
-  SetTexturePositions();
+  UpdateScrollUniform();
 }
 
 void ScrollableRenderTexture::UpdateMargins(const Margins& newMargins) {
@@ -180,6 +310,7 @@ void ScrollableRenderTexture::UpdateMargins(const Margins& newMargins) {
   }
 
   margins = newMargins;
+  drawVersion = NextDrawVersion();
 }
 
 void ScrollableRenderTexture::AddOrRemoveTextures() {
@@ -190,7 +321,8 @@ void ScrollableRenderTexture::AddOrRemoveTextures() {
     .height = size.y + glm::abs(scrollDist),
   };
 
-  std::vector<RenderTextureHandle> removed;
+  // removed segments are reused first, then go back to the pool
+  std::vector<RenderTexturePool::Handle> removed;
   // remove from the top
   int numRemoved = 0;
   for (size_t i = 0; i < renderTextures.size(); i++) {
@@ -224,7 +356,7 @@ void ScrollableRenderTexture::AddOrRemoveTextures() {
       return handle;
     }
     auto texSize = glm::vec2(size.x, textureHeight);
-    return std::make_unique<RenderTexture>(texSize, dpiScale, format);
+    return renderTexturePool.Acquire(texSize, dpiScale, format);
   };
 
   // add from top
@@ -249,43 +381,57 @@ void ScrollableRenderTexture::AddOrRemoveTextures() {
   }
 
   baseOffset = region.pos - posChange;
+  drawVersion = NextDrawVersion();
 }
 
 void ScrollableRenderTexture::SetTexturePositions() {
   for (size_t i = 0; i < renderTextures.size(); i++) {
-    auto& texture = *renderTextures[i];
-    float yposTop = -(baseOffset + scrollCurr) + (i * textureHeight);
-    float yposBottom = yposTop + textureHeight;
+    renderTextures[i]->UpdatePos(posOffset + glm::vec2(0, i * textureHeight));
+  }
+}
 
-    if (yposBottom <= 0 || yposTop >= size.y) {
-      texture.disabled = true;
-      continue;
-    }
+void ScrollableRenderTexture::UpdateScrollUniform() {
+  float scrollOffset = baseOffset + scrollCurr;
 
-    if (yposTop < 0) {
-      texture.UpdatePos(
-        posOffset,
-        Rect{
-          .pos = {0, -yposTop},
-          .size = {size.x, textureHeight + yposTop},
-        }
-      );
-
-    } else if (yposBottom > size.y) {
-      texture.UpdatePos(
-        posOffset + glm::vec2(0, yposTop),
-        Rect{
-          .pos = {0, 0},
-          .size = {size.x, textureHeight - (yposBottom - size.y)},
-        }
-      );
-
-    } else {
-      texture.UpdatePos(posOffset + glm::vec2(0, yposTop));
+  for (size_t i = 0; i < renderTextures.size(); i++) {
+    float yposTop = -scrollOffset + (i * textureHeight);
+    float yposBottom = yposTop + textureHeight;
+    bool disabled = yposBottom <= visibleTop || yposTop >= visibleBottom;
+    if (renderTextures[i]->disabled != disabled) {
+      renderTextures[i]->disabled = disabled;
+      drawVersion = NextDrawVersion();
     }
-
-    texture.disabled = false;
   }
+
+  // parts of segments outside the visible window are clipped in the shader
+  ScrollUniform newUniform{
+    .offset = {0, -scrollOffset},
+    .clipMin = posOffset + glm::vec2(0, visibleTop),
+    .clipMax = posOffset + glm::vec2(size.x, visibleBottom),
+  };
+  if (newUniform == scrollUniform) return;
+  scrollUniform = newUniform;
+  ctx.queue.WriteBuffer(scrollBuffer, 0, &scrollUniform, sizeof(ScrollUniform));
+}
+
+void ScrollableRenderTexture::UpdateMarginScrollUniform() {
+  ScrollUniform marginUniform{
+    .offset = {0, 0},
+    .clipMin = posOffset + glm::vec2(0, visibleTop),
+    .clipMax = posOffset + glm::vec2(size.x, visibleBottom),
+  };
+  ctx.queue.WriteBuffer(marginScrollBuffer, 0, &marginUniform, sizeof(ScrollUniform));
+}
+
+void ScrollableRenderTexture::SetVisibleRows(int start, int end) {
+  float top = start * charSize.y;
+  float bottom = glm::min(end * charSize.y, size.y);
+  if (top == visibleTop && bottom == visibleBottom) return;
+  visibleTop = top;
+  visibleBottom = bottom;
+  drawVersion = NextDrawVersion(); // margins may be skipped
+  UpdateScrollUniform();
+  UpdateMarginScrollUniform();
 }
 
 void ScrollableRenderTexture::SetTextureCameraPositions() {
@@ -303,11 +449,15 @@ std::vector<RenderInfo> ScrollableRenderTexture::GetRenderInfos(int maxRows) con
   int topOffset = newBaseOffset / charSize.y;
   int bottomOffset = (newBaseOffset + size.y) / charSize.y;
 
-  int innerTopOffset = topOffset + margins.top;
-  int innerBottomOffset = bottomOffset - margins.bottom;
-
   int totalRows = size.y / charSize.y;
 
+  // rows rendered to segments, relative to the top of the viewport
+  int rowsStart = margins.top - cachedRowsAbove;
+  int rowsEnd = glm::min(totalRows - margins.bottom, maxRows) + cachedRowsBelow;
+
+  int innerTopOffset = topOffset + rowsStart;
+  int innerBottomOffset = bottomOffset - margins.bottom + cachedRowsBelow;
+
   std::vector<RenderInfo> renderInfos;
 
   for (size_t i = 0; i < renderTextures.size(); i++) {
@@ -321,10 +471,9 @@ std::vector<RenderInfo> ScrollableRenderTexture::GetRenderInfos(int maxRows) con
       .texture = renderTextures[i].get(),
     });
 
-    int start = glm::max(top - topOffset, margins.top);
-    int end = glm::min(bottom - topOffset, totalRows - margins.bottom);
-    start = glm::min(start, maxRows);
-    end = glm::min(end, maxRows);
+    int start = glm::max(top - topOffset, rowsStart);
+    int end = glm::min(bottom - topOffset, rowsEnd);
+    start = glm::min(start, end);
     renderInfo.range = {start, end};
 
     if (top < innerTopOffset && scrollDist > 0) {
@@ -365,18 +514,30 @@ std::vector<RenderInfo> ScrollableRenderTexture::GetRenderInfos(int maxRows) con
   return renderInfos;
 }
 
-void ScrollableRenderTexture::Render(const wgpu::RenderPassEncoder& passEncoder, uint32_t groupIndex) const {
-  if (marginTextures.top != nullptr) {
-    passEncoder.SetBindGroup(groupIndex, marginTextures.top->textureBG);
-    marginTextures.top->renderData.Render(passEncoder);
+void ScrollableRenderTexture::Render(
+  const wgpu::RenderBundleEncoder& bundleEncoder,
+  uint32_t groupIndex,
+  uint32_t scrollGroupIndex
+) const {
+  bundleEncoder.SetBindGroup(scrollGroupIndex, marginScrollBG);
+  if (marginTextures.top != nullptr && visibleTop < fmargins.top) {
+    bundleEncoder.SetBindGroup(groupIndex, marginTextures.top->textureBG);
+    marginTextures.top->renderData.Render(bundleEncoder);
   }
-  if (marginTextures.bottom != nullptr) {
-    passEncoder.SetBindGroup(groupIndex, marginTextures.bottom->textureBG);
-    marginTextures.bottom->renderData.Render(passEncoder);
+  if (marginTextures.bottom != nullptr &&
+      visibleBottom > size.y - fmargins.bottom) {
+    bundleEncoder.SetBindGroup(groupIndex, marginTextures.bottom->textureBG);
+    marginTextures.bottom->renderData.Render(bundleEncoder);
   }
+  bundleEncoder.SetBindGroup(scrollGroupIndex, scrollBG);
+  // segments on the same tile atlas page share the bind group
+  WGPUBindGroup boundBG = nullptr;
   for (const auto& renderTexture : renderTextures) {
     if (renderTexture->disabled) continue;
-    passEncoder.SetBindGroup(groupIndex, renderTexture->textureBG);
-    renderTexture->renderData.Render(passEncoder);
+    if (renderTexture->textureBG.Get() != boundBG) {
+      bundleEncoder.SetBindGroup(groupIndex, renderTexture->textureBG);
+      boundBG = renderTexture->textureBG.Get();
+    }
+    renderTexture->renderData.Render(bundleEncoder);
   }
 }
@@ -5,20 +5,29 @@
 #include "webgpu/webgpu_cpp.h"
 #include "gfx/camera.hpp"
 #include "gfx/quad.hpp"
+#include "gfx/tile_atlas.hpp"
 #include "glm/ext/vector_float2.hpp"
+#include <list>
 #include <memory>
 #include <optional>
+#include <cstdint>
 #include <deque>
 
 // convenience wrapper over wgpu::Texture
 struct RenderTexture {
   Ortho2D camera;
+  glm::vec2 cameraPos{};
 
   glm::vec2 size;
+  float dpiScale = 1;
   wgpu::Texture texture;
   wgpu::TextureView textureView;
   wgpu::BindGroup textureBG;
 
+  // set when this is a region of a tileAtlas page, texture and views are the
+  // page's. passes rendering to it need SetViewport, and can't clear.
+  std::optional<TileAtlas::Tile> tile;
+
   QuadRenderData<TextureQuadVertex> renderData;
 
   bool disabled = false;
@@ -30,6 +39,10 @@ struct RenderTexture {
     wgpu::TextureFormat format,
     const void* data = nullptr
   );
+  RenderTexture(glm::vec2 size, float dpiScale, TileAtlas::Tile tile);
+
+  // restricts rendering to the tile, does nothing for standalone textures
+  void SetViewport(const wgpu::RenderPassEncoder& passEncoder) const;
 
   // pos is the position (top left) of the texture in the screen
   // region is the subregion of the texture to draw
@@ -39,6 +52,54 @@ struct RenderTexture {
 
 using RenderTextureHandle = std::unique_ptr<RenderTexture>;
 
+// Process wide pool of unused render textures, shared by all windows.
+// Textures are matched by size, dpi scale and format. Least recently released
+// textures are destroyed when the pool is over budget. Render thread only.
+struct RenderTexturePool {
+  struct Key {
+    float width;
+    float height;
+    float dpiScale;
+    wgpu::TextureFormat format;
+    bool operator==(const Key&) const = default;
+  };
+
+  struct Entry {
+    Key key;
+    size_t bytes;
+    RenderTextureHandle texture;
+  };
+
+  // returns the texture to the pool instead of destroying it
+  struct Releaser {
+    void operator()(RenderTexture* texture) const;
+  };
+  using Handle = std::unique_ptr<RenderTexture, Releaser>;
+
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+  };
+
+  size_t budget = 128 << 20; // bytes of unused textures kept
+  size_t pooledBytes = 0;
+  std::list<Entry> entries; // front is most recently released
+  Stats stats;
+
+  Handle Acquire(glm::vec2 size, float dpiScale, wgpu::TextureFormat format);
+  void Release(RenderTextureHandle texture);
+  // evicts right away if the pool is over the new budget
+  void SetBudget(size_t bytes);
+  // destroys all pooled textures and logs stats, call before the device is gone
+  void Clear();
+
+private:
+  void Trim();
+};
+
+inline RenderTexturePool renderTexturePool;
+
 struct RenderInfo {
   const RenderTexture* texture;
   struct {
@@ -55,6 +116,15 @@ struct MarginTextures {
   RenderTextureHandle right;
 };
 
+// scroll offset and clip rect applied to the segments in the texture shader
+struct ScrollUniform {
+  glm::vec2 offset;
+  glm::vec2 clipMin;
+  glm::vec2 clipMax;
+  glm::vec2 _pad;
+  bool operator==(const ScrollUniform&) const = default;
+};
+
 // consists of multiple render textures that can be scrolled
 struct ScrollableRenderTexture {
   glm::vec2 posOffset;
@@ -74,7 +144,8 @@ struct ScrollableRenderTexture {
   FMargins fmargins;
   MarginTextures marginTextures;
 
-  std::deque<RenderTextureHandle> renderTextures;
+  // segments go back to renderTexturePool when removed or destroyed
+  std::deque<RenderTexturePool::Handle> renderTextures;
   float baseOffset = 0; // offset representing top of viewport (prescroll)
 
   bool scrolling = false;
@@ -82,8 +153,30 @@ struct ScrollableRenderTexture {
   float scrollCurr = 0; // 0 <= scrollCurr <= scrollDist
   float scrollElapsed = 0;
   float scrollTime = 0.25; // transition time
-
-  QuadRenderData<RectQuadVertex> clearData;
+  // rows between the old and new viewport of a long jump, rendered from the
+  // window's row cache. above for scrolling down, below for scrolling up
+  int cachedRowsAbove = 0;
+  int cachedRowsBelow = 0;
+
+  QuadRenderData<RectQuadVertex, true> clearData;
+
+  // segment quads only change when segments are added or the window moves,
+  // scroll animation frames only write scrollBuffer
+  ScrollUniform scrollUniform{};
+  wgpu::Buffer scrollBuffer;
+  wgpu::BindGroup scrollBG;
+  // margins don't scroll
+  wgpu::Buffer marginScrollBuffer;
+  wgpu::BindGroup marginScrollBG;
+
+  // part of the window not hidden by windows in front, composition is clipped
+  // to it
+  float visibleTop = 0;
+  float visibleBottom = 0;
+
+  // unique per change of the draws in Render, so recorded render bundles know
+  // when they're stale. 0 when never drawn
+  uint64_t drawVersion = 0;
 
   ScrollableRenderTexture() = default;
   ScrollableRenderTexture(glm::vec2 size, float dpiScale, glm::vec2 charSize);
@@ -91,18 +184,29 @@ struct ScrollableRenderTexture {
   float RoundOffset(float offset) const;
 
   void UpdatePos(glm::vec2 pos);
-  void UpdateViewport(float newScrollDist = 0);
+  void UpdateViewport(float newScrollDist = 0, int cachedRows = 0);
   void UpdateScrolling(float dt);
   void UpdateMargins(const Margins& newMargins);
 
   void AddOrRemoveTextures();
+  // segment quads at unscrolled positions
   void SetTexturePositions();
+  // scroll offset and visibility of segments
+  void UpdateScrollUniform();
+  void UpdateMarginScrollUniform();
+  void SetVisibleRows(int start, int end);
   void SetTextureCameraPositions();
 
   // returns pointer to render texture and a row range to render to it
   // limit max rows, so when win.height != grid.height, doesn't blow up
+  // rows are relative to the top of the viewport, cached rows are out of
+  // [0, maxRows)
   std::vector<RenderInfo> GetRenderInfos(int maxRows) const;
 
-  // render entire scrollable render texture
-  void Render(const wgpu::RenderPassEncoder& passEncoder, uint32_t groupIndex) const;
+  // record entire scrollable render texture
+  void Render(
+    const wgpu::RenderBundleEncoder& bundleEncoder,
+    uint32_t groupIndex,
+    uint32_t scrollGroupIndex
+  ) const;
 };
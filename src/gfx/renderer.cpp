@@ -9,13 +9,21 @@
 #include "utils/region.hpp"
 #include "utils/unicode.hpp"
 #include "utils/color.hpp"
+#include "utils/timer.hpp"
 #include "webgpu_tools/utils/webgpu.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
 #include <utility>
 #include <vector>
 #include <array>
+#include "glm/common.hpp"
+#include "glm/vector_relational.hpp"
 #include "glm/gtx/string_cast.hpp"
 
 using namespace wgpu;
+using namespace std::chrono;
 
 Renderer::Renderer(const SizeHandler& sizes) {
   // color stuff
@@ -38,10 +46,6 @@ Renderer::Renderer(const SizeHandler& sizes) {
   // shared
   camera = Ortho2D(sizes.size);
 
-  finalRenderTexture =
-    RenderTexture(sizes.uiSize, sizes.dpiScale, TextureFormat::RGBA8UnormSrgb);
-  finalRenderTexture.UpdatePos(sizes.offset);
-
   // rect
   rectRPD = utils::RenderPassDescriptor({
     RenderPassColorAttachment{
@@ -56,24 +60,9 @@ Renderer::Renderer(const SizeHandler& sizes) {
     },
   });
 
-  // text
-  textRPD = utils::RenderPassDescriptor({
-    RenderPassColorAttachment{
-      .loadOp = LoadOp::Load,
-      .storeOp = StoreOp::Store,
-    },
-  });
-
-  // shapes
-  shapesRPD = utils::RenderPassDescriptor({
-    RenderPassColorAttachment{
-      .loadOp = LoadOp::Load,
-      .storeOp = StoreOp::Store,
-    },
-  });
-
   // text mask
   textMaskData.CreateBuffers(1);
+  shapeMaskData.CreateBuffers(1);
   textMaskRPD = utils::RenderPassDescriptor({
     RenderPassColorAttachment{
       .loadOp = LoadOp::Clear,
@@ -82,21 +71,15 @@ Renderer::Renderer(const SizeHandler& sizes) {
     },
   });
 
-  // windows
-  auto stencilTextureView =
-    utils::CreateRenderTexture(ctx.device, {sizes.uiFbSize, TextureFormat::Stencil8})
-    .CreateView();
-
+  // windows, views are set in AllocateTargets
   windowsRPD = utils::RenderPassDescriptor(
     {
       RenderPassColorAttachment{
-        .view = finalRenderTexture.textureView,
         .loadOp = LoadOp::Undefined, // set later in RenderWindows
         .storeOp = StoreOp::Store,
       },
     },
     RenderPassDepthStencilAttachment{
-      .view = stencilTextureView,
       .stencilLoadOp = LoadOp::Clear,
       .stencilStoreOp = StoreOp::Store,
       .stencilClearValue = 0,
@@ -119,24 +102,68 @@ Renderer::Renderer(const SizeHandler& sizes) {
       .storeOp = StoreOp::Store,
     },
   });
-}
 
-void Renderer::Resize(const SizeHandler& sizes) {
-  camera.Resize(sizes.size);
+  AllocateTargets(BucketSize(sizes.uiFbSize), sizes.dpiScale);
+  SetFinalRegion(sizes);
+}
 
-  if (!prevFinalRenderTexture.texture) {
-    prevFinalRenderTexture = std::move(finalRenderTexture);
-  }
+glm::vec2 Renderer::BucketSize(glm::vec2 fbSize) {
+  return glm::ceil(fbSize / targetBucket) * targetBucket;
+}
 
+void Renderer::AllocateTargets(glm::vec2 fbSize, float dpiScale) {
   finalRenderTexture =
-    RenderTexture(sizes.uiSize, sizes.dpiScale, TextureFormat::RGBA8UnormSrgb);
-  finalRenderTexture.UpdatePos(sizes.offset);
+    RenderTexture(fbSize / dpiScale, dpiScale, TextureFormat::RGBA8UnormSrgb);
   windowsRPD.cColorAttachments[0].view = finalRenderTexture.textureView;
 
+  // same size expression as the color target, so they always match
   auto stencilTextureView =
-    utils::CreateRenderTexture(ctx.device, {sizes.uiFbSize, TextureFormat::Stencil8})
+    utils::CreateRenderTexture(
+      ctx.device, {finalRenderTexture.size * dpiScale, TextureFormat::Stencil8}
+    )
     .CreateView();
   windowsRPD.cDepthStencilAttachmentInfo.view = stencilTextureView;
+
+  // bundles bind the camera of the old texture
+  windowsBundle = {};
+  floatWindowsBundle = {};
+
+  targetFbSize = fbSize;
+  targetDpiScale = dpiScale;
+}
+
+void Renderer::SetFinalRegion(const SizeHandler& sizes) {
+  uiFbSize = sizes.uiFbSize;
+  finalRenderTexture.camera.Resize(sizes.uiSize);
+  finalRenderTexture.UpdatePos(
+    sizes.offset, Rect{.pos = {0, 0}, .size = sizes.uiSize}
+  );
+}
+
+void Renderer::Resize(const SizeHandler& sizes) {
+  camera.Resize(sizes.size);
+  damaged = true;
+
+  bool fits = sizes.dpiScale == targetDpiScale &&
+              glm::all(glm::lessThanEqual(sizes.uiFbSize, targetFbSize));
+  if (!fits) {
+    if (!prevFinalRenderTexture.texture) {
+      prevFinalRenderTexture = std::move(finalRenderTexture);
+    }
+    // a bucket of headroom, so the rest of the resize fits
+    AllocateTargets(BucketSize(sizes.uiFbSize) + targetBucket, sizes.dpiScale);
+  }
+  SetFinalRegion(sizes);
+}
+
+bool Renderer::ShrinkTargets(const SizeHandler& sizes) {
+  auto fbSize = BucketSize(sizes.uiFbSize);
+  if (fbSize == targetFbSize) return false;
+
+  AllocateTargets(fbSize, sizes.dpiScale);
+  SetFinalRegion(sizes);
+  damaged = true;
+  return true;
 }
 
 void Renderer::SetColors(const glm::vec4& color, float gamma) {
@@ -149,21 +176,39 @@ void Renderer::SetColors(const glm::vec4& color, float gamma) {
   if (this->gamma != gamma) {
     ctx.queue.WriteBuffer(gammaBuffer, 0, &gamma, sizeof(gamma));
     this->gamma = gamma;
+    damaged = true;
   }
 
   auto linearColor = ToLinear(color, gamma);
   if (this->linearColor != linearColor) {
     ctx.queue.WriteBuffer(linearColorBuffer, 0, &linearColor, sizeof(linearColor));
     this->linearColor = linearColor;
+    damaged = true;
   }
 }
 
 void Renderer::Begin() {
-  commandEncoder = ctx.device.CreateCommandEncoder();
-  SurfaceTexture surfaceTexture;
-  ctx.surface.GetCurrentTexture(&surfaceTexture);
-  nextTexture = surfaceTexture.texture;
-  nextTextureView = nextTexture.CreateView();
+  windowsRendered = false;
+}
+
+wgpu::CommandEncoder& Renderer::Encoder() {
+  if (!commandEncoder) commandEncoder = ctx.device.CreateCommandEncoder();
+  return commandEncoder;
+}
+
+void Renderer::UpdateCursorDamage(const Cursor& cursor) {
+  CursorFrame cursorFrame{.visible = false};
+  if (cursor.ShouldRender()) {
+    cursorFrame = {
+      .visible = true,
+      .pos = cursor.pos,
+      .corners = cursor.corners,
+      .attrId = cursor.cursorMode->attrId,
+    };
+  }
+  if (cursorFrame == presentedCursor) return;
+  presentedCursor = cursorFrame;
+  damaged = true;
 }
 
 void Renderer::RenderToWindow(
@@ -183,38 +228,81 @@ void Renderer::RenderToWindow(
     // if (win.grid.width != win.width) return;
   }
 
-  // keep track of quad index after each row
-  size_t rows = std::min(win.grid.height, win.height);
+  auto startTime = Time();
+  if (!windowsRendered) {
+    windowsRendered = true;
+    stats.frames++;
+  }
+
+  int rows = std::min(win.grid.height, win.height);
   size_t cols = std::min(win.grid.width, win.width);
-  std::vector<int> rectIntervals; rectIntervals.reserve(rows + 1);
-  std::vector<int> textIntervals; textIntervals.reserve(rows + 1);
-  std::vector<int> shapeIntervals; shapeIntervals.reserve(rows + 1);
+  auto renderInfos = win.sRenderTexture.GetRenderInfos(rows);
+  stats.segments += renderInfos.size();
+
+  // rows out of the grid are scrolled over by a long jump, they come from the
+  // row cache
+  int firstRow = 0;
+  int lastRow = rows;
+  for (const auto& renderInfo : renderInfos) {
+    firstRow = std::min(firstRow, renderInfo.range.start);
+    lastRow = std::max(lastRow, renderInfo.range.end);
+  }
+  size_t numRows = lastRow - firstRow;
+
+  // keep track of quad index after each row
+  std::vector<int> rectIntervals; rectIntervals.reserve(numRows + 1);
+  std::vector<int> textIntervals; textIntervals.reserve(numRows + 1);
+  std::vector<int> colorTextIntervals; colorTextIntervals.reserve(numRows + 1);
+  std::vector<int> boxTextIntervals; boxTextIntervals.reserve(numRows + 1);
+  std::vector<int> shapeIntervals; shapeIntervals.reserve(numRows + 1);
 
   auto& rectData = win.rectData;
   auto& textData = win.textData;
+  auto& colorTextData = win.colorTextData;
+  auto& boxTextData = win.boxTextData;
   auto& shapeData = win.shapeData;
 
   rectData.ResetCounts();
   textData.ResetCounts();
+  colorTextData.ResetCounts();
+  boxTextData.ResetCounts();
   shapeData.ResetCounts();
 
   glm::vec2 textOffset(0, 0);
   const auto& defaultFont = fontFamily.DefaultFont();
   auto defaultBG = GetDefaultBackground(hlTable);
+  std::string runTexts;
+  // cells without a background quad show the clear color
+  bool opaque = true;
 
-  for (size_t row = 0; row < rows; row++) {
-    auto& line = win.grid.lines[row];
-    textOffset.x = 0;
-
+  textOffset.y = firstRow * defaultFont.charSize.y;
+  for (int row = firstRow; row < lastRow; row++) {
     rectIntervals.push_back(rectData.quadCount);
     textIntervals.push_back(textData.quadCount);
+    colorTextIntervals.push_back(colorTextData.quadCount);
+    boxTextIntervals.push_back(boxTextData.quadCount);
     shapeIntervals.push_back(shapeData.quadCount);
 
+    const Grid::Line* cachedLine = nullptr;
+    if (row < 0 || row >= rows) {
+      cachedLine = win.rowCache.Find(win.scrollRow + row);
+      if (cachedLine == nullptr || cachedLine->size() < cols) {
+        textOffset.y += defaultFont.charSize.y;
+        continue;
+      }
+    }
+    const auto& line = cachedLine ? *cachedLine : win.grid.lines[row];
+    textOffset.x = 0;
+
+    size_t runEnd = 0;
     for (size_t col = 0; col < cols; col++) {
       auto& cell = line[col];
       const Highlight& hl = hlTable[cell.hlId];
       // don't render background if default
-      if (cell.hlId != 0 && hl.background.has_value() && hl.background != defaultBG) {
+      bool hasBackground =
+        cell.hlId != 0 && hl.background.has_value() && hl.background != defaultBG;
+      opaque = opaque && (hasBackground ? hl.bgAlpha == 1 : defaultBG.a == 1);
+      if (hasBackground) {
         auto rectPositions = MakeRegion({0, 0}, defaultFont.charSize);
 
         auto background = *hl.background;
@@ -226,78 +314,59 @@ void Renderer::RenderToWindow(
         }
       }
 
-      if (!cell.text.empty() && cell.text != " ") {
-        glm::vec4 foreground = GetForeground(hlTable, hl);
-        char32_t charcode = UTF8ToChar32(cell.text);
-
-        if (charcode >= 0x2800 && charcode <= 0x28FF) { // braille characters
-          // order, hex value
-          // 0 3    1 8
-          // 1 4    2 10
-          // 2 5    4 20
-          // 6 7    8 80
-
-          uint32_t hexVal = charcode - 0x2800; 
-
-          std::span<const glm::vec2> brailleOffsets;
-          int numDots = 0;
-
-          if (charcode < 0x2840) { // 6 dots
-            static const glm::vec2 sixDotBrailleOffsets[6] = {
-              {1/4., 1/6.},
-              {1/4., 3/6.},
-              {1/4., 5/6.},
-              {3/4., 1/6.},
-              {3/4., 3/6.},
-              {3/4., 5/6.},
-            };
-            brailleOffsets = sixDotBrailleOffsets;
-            numDots = 6;
-            
-          } else { // 8 dots
-            static const glm::vec2 eightDotBrailleOffsets[8] = {
-              {1/4., 1/8.},
-              {1/4., 3/8.},
-              {1/4., 5/8.},
-              {3/4., 1/8.},
-              {3/4., 3/8.},
-              {3/4., 5/8.},
-              {1/4., 7/8.},
-              {3/4., 7/8.},
-            };
-            brailleOffsets = eightDotBrailleOffsets;
-            numDots = 8;
-          }
-
-          for (int dotIndex = 0; dotIndex < numDots; dotIndex++) {
-            if (!(hexVal & (1 << dotIndex))) continue;
+      // text is shaped a run of same highlight cells at a time
+      if (col == runEnd) {
+        runEnd = col + 1;
+        while (runEnd < cols && line[runEnd].hlId == cell.hlId) runEnd++;
 
-            auto charSize = defaultFont.charSize;
-            auto centerPos = brailleOffsets[dotIndex] * charSize;
+        runTexts.clear();
+        for (size_t c = col; c < runEnd; c++) {
+          runTexts += line[c].text;
+          runTexts += '\0';
+        }
 
-            int xNumDots = 2;
-            int yNumDots = numDots / 2;
-            float radius =
-              std::min(charSize.x / xNumDots, charSize.y / yNumDots) / 2;
-            radius *= 0.6; // add some padding
+        // glyphs are placed on whole pixels, the fraction of the run start picks
+        // the subpixel variants. whole pixel cells only need float error rounded
+        constexpr int buckets = Font::subpixelBuckets;
+        float runPixelX = textOffset.x * defaultFont.dpiScale;
+        float runSnappedX = std::floor(runPixelX);
+        int startSubpixel = 0;
+        if (defaultFont.fractionalWidth) {
+          startSubpixel =
+            std::min(int((runPixelX - runSnappedX) * buckets), buckets - 1);
+        } else {
+          runSnappedX = std::round(runPixelX);
+        }
+        glm::vec2 runOffset(runSnappedX / defaultFont.dpiScale, textOffset.y);
 
+        glm::vec4 foreground = GetForeground(hlTable, hl);
+        const auto& run =
+          fontFamily.ShapeRun(runTexts, hl.bold, hl.italic, startSubpixel);
+        for (const auto& glyph : run) {
+          if (glyph.gpuDesc.has_value()) {
+            // offset is the unsnapped cell position
             Rect quadRect{
-              .pos = textOffset + (centerPos - glm::vec2(radius, radius)),
-              .size = glm::vec2(radius * 2, radius * 2),
+              .pos = textOffset + glyph.offset, .size = defaultFont.charSize
             };
-            static uint32_t brailleShapeId = 5;
-            AddShapeQuad(shapeData, quadRect, foreground, brailleShapeId);
+            AddShapeQuad(
+              shapeData, quadRect, foreground, BoxDrawing::gpuShapeType,
+              *glyph.gpuDesc
+            );
+            continue;
           }
 
-        } else {
-          const auto& glyphInfo = fontFamily.GetGlyphInfo(charcode, hl.bold, hl.italic);
+          glm::vec2 glyphOffset = runOffset + glyph.offset;
 
+          const auto& glyphInfo = *glyph.glyphInfo;
           glm::vec2 textQuadPos{
-            textOffset.x,
-            textOffset.y + (glyphInfo.boxDrawing ? 0 : defaultFont.ascender)
+            glyphOffset.x,
+            glyphOffset.y + (glyphInfo.boxDrawing ? 0 : defaultFont.ascender)
           };
 
-          auto& quad = textData.NextQuad();
+          auto& data = glyphInfo.color                          ? colorTextData
+                       : fontFamily.InBoxAtlas(glyph.charcode) ? boxTextData
+                                                               : textData;
+          auto& quad = data.NextQuad();
           for (size_t i = 0; i < 4; i++) {
             quad[i].position = textQuadPos + glyphInfo.localPoss[i];
             quad[i].regionCoord = glyphInfo.atlasRegion[i];
@@ -349,83 +418,148 @@ void Renderer::RenderToWindow(
 
   rectIntervals.push_back(rectData.quadCount);
   textIntervals.push_back(textData.quadCount);
+  colorTextIntervals.push_back(colorTextData.quadCount);
+  boxTextIntervals.push_back(boxTextData.quadCount);
   shapeIntervals.push_back(shapeData.quadCount);
+  win.opaque = opaque;
 
   rectData.WriteBuffers();
   textData.WriteBuffers();
+  colorTextData.WriteBuffers();
+  boxTextData.WriteBuffers();
   shapeData.WriteBuffers();
 
   // gpu texture is reallocated if resized
   // old gpu texture is not referenced by texture atlas anymore
   // but still referenced by command encoder if used by previous windows
   fontFamily.textureAtlas.Update();
+  if (fontFamily.sdf) fontFamily.boxAtlas.Update();
+
+  // tiles share their page with other windows and can't be cleared by the pass,
+  // clear them with a quad instead. quads of all textures are written at once
+  // since buffer writes happen before the command encoder runs.
+  auto& clearData = win.sRenderTexture.clearData;
+  clearData.ResetCounts();
+  std::vector<int> clearQuads(renderInfos.size(), -1);
+  for (size_t i = 0; i < renderInfos.size(); i++) {
+    const auto& [renderTexture, range, clearRegion] = renderInfos[i];
+    auto clearRect = clearRegion;
+    if (!clearRect && renderTexture->tile) {
+      clearRect = Rect{.pos = renderTexture->cameraPos, .size = renderTexture->size};
+    }
+    if (!clearRect) continue;
+
+    clearQuads[i] = clearData.quadCount;
+    auto region = clearRect->Region();
+    auto& quad = clearData.NextQuad();
+    for (size_t j = 0; j < 4; j++) {
+      quad[j].position = region[j];
+      quad[j].color = ToGlmColor(clearColor);
+    }
+  }
+  clearData.WriteBuffers();
+
+  // one pass per target texture, backgrounds, text and shapes are drawn in the
+  // same pass. tiles of the same page share a pass, each drawn with its own
+  // viewport and camera
+  std::vector<size_t> order(renderInfos.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, std::less{}, [&](size_t i) {
+    return renderInfos[i].texture->textureView.Get();
+  });
 
-  auto renderInfos = win.sRenderTexture.GetRenderInfos(rows);
+  for (size_t passStart = 0; passStart < order.size();) {
+    auto textureView = renderInfos[order[passStart]].texture->textureView;
+    size_t passEnd = passStart + 1;
+    while (passEnd < order.size() &&
+           renderInfos[order[passEnd]].texture->textureView.Get() ==
+             textureView.Get()) {
+      passEnd++;
+    }
 
-  for (auto& [renderTexture, range, clearRegion] : renderInfos) {
-    // clear window, and render backgrounds
-    int start = rectIntervals[range.start];
-    int end = rectIntervals[range.end];
-    {
-      auto& currRPD = clearRegion.has_value() ? rectNoClearRPD : rectRPD;
-      currRPD.cColorAttachments[0].view = renderTexture->textureView;
-      currRPD.cColorAttachments[0].clearValue = linearClearColor;
-      RenderPassEncoder passEncoder = commandEncoder.BeginRenderPass(&currRPD);
-      passEncoder.SetPipeline(ctx.pipeline.rectRPL);
+    // only a standalone texture without a clear region is cleared by the pass
+    bool clearQuad = clearQuads[order[passStart]] != -1;
+    auto& currRPD = clearQuad ? rectNoClearRPD : rectRPD;
+    currRPD.cColorAttachments[0].view = textureView;
+    currRPD.cColorAttachments[0].clearValue = linearClearColor;
+    RenderPassEncoder passEncoder = Encoder().BeginRenderPass(&currRPD);
+    stats.renderPasses++;
+    passEncoder.SetBindGroup(1, gammaBG);
+
+    for (size_t j = passStart; j < passEnd; j++) {
+      size_t i = order[j];
+      const auto& [renderTexture, range, clearRegion] = renderInfos[i];
+      renderTexture->SetViewport(passEncoder);
       passEncoder.SetBindGroup(0, renderTexture->camera.viewProjBG);
-      passEncoder.SetBindGroup(1, gammaBG);
-
-      // this will only be ran at most once inside this loop,
-      // so it's safe reset and write buffers directly inside
-      if (clearRegion.has_value()) {
-        auto& clearData = win.sRenderTexture.clearData;
-        clearData.ResetCounts();
-        auto region = clearRegion->Region();
-        auto& quad = clearData.NextQuad();
-        for (size_t i = 0; i < 4; i++) {
-          quad[i].position = region[i];
-          quad[i].color = ToGlmColor(clearColor);
-        }
-        clearData.WriteBuffers();
-        clearData.Render(passEncoder);
+
+      // clear and render backgrounds
+      int start = rectIntervals[range.start - firstRow];
+      int end = rectIntervals[range.end - firstRow];
+      if (clearQuads[i] != -1 || start != end) {
+        passEncoder.SetPipeline(ctx.pipeline.rectRPL);
+        if (clearQuads[i] != -1) clearData.Render(passEncoder, clearQuads[i], 1);
+        if (start != end) rectData.Render(passEncoder, start, end - start);
       }
 
-      if (start != end) rectData.Render(passEncoder, start, end - start);
-      passEncoder.End();
-    }
+      // render text
+      start = textIntervals[range.start - firstRow];
+      end = textIntervals[range.end - firstRow];
+      if (start != end) {
+        passEncoder.SetPipeline(
+          fontFamily.sdf ? ctx.pipeline.textSdfRPL : ctx.pipeline.textRPL
+        );
+        passEncoder.SetBindGroup(2, fontFamily.textureAtlas.textureSizeBG);
+        passEncoder.SetBindGroup(3, fontFamily.textureAtlas.renderTexture.textureBG);
+        textData.Render(passEncoder, start, end - start);
+      }
 
-    // render text
-    start = textIntervals[range.start];
-    end = textIntervals[range.end];
-    if (start != end) {
-      textRPD.cColorAttachments[0].view = renderTexture->textureView;
-      RenderPassEncoder passEncoder = commandEncoder.BeginRenderPass(&textRPD);
-      passEncoder.SetPipeline(ctx.pipeline.textRPL);
-      passEncoder.SetBindGroup(0, renderTexture->camera.viewProjBG);
-      passEncoder.SetBindGroup(1, gammaBG);
-      passEncoder.SetBindGroup(2, fontFamily.textureAtlas.textureSizeBG);
-      passEncoder.SetBindGroup(3, fontFamily.textureAtlas.renderTexture.textureBG);
-      if (start != end) textData.Render(passEncoder, start, end - start);
-      passEncoder.End();
-    }
+      start = colorTextIntervals[range.start - firstRow];
+      end = colorTextIntervals[range.end - firstRow];
+      if (start != end) {
+        auto& colorPage = *fontFamily.textureAtlas.colorPage;
+        passEncoder.SetPipeline(ctx.pipeline.colorTextRPL);
+        passEncoder.SetBindGroup(2, colorPage.textureSizeBG);
+        passEncoder.SetBindGroup(3, colorPage.renderTexture.textureBG);
+        colorTextData.Render(passEncoder, start, end - start);
+      }
 
-    // render braille
-    start = shapeIntervals[range.start];
-    end = shapeIntervals[range.end];
-    if (start != end) {
-      shapesRPD.cColorAttachments[0].view = renderTexture->textureView;
-      RenderPassEncoder passEncoder = commandEncoder.BeginRenderPass(&shapesRPD);
-      passEncoder.SetPipeline(ctx.pipeline.shapesRPL);
-      passEncoder.SetBindGroup(0, renderTexture->camera.viewProjBG);
-      passEncoder.SetBindGroup(1, gammaBG);
-      if (start != end) shapeData.Render(passEncoder, start, end - start);
-      passEncoder.End();
+      start = boxTextIntervals[range.start - firstRow];
+      end = boxTextIntervals[range.end - firstRow];
+      if (start != end) {
+        passEncoder.SetPipeline(ctx.pipeline.textRPL);
+        passEncoder.SetBindGroup(2, fontFamily.boxAtlas.textureSizeBG);
+        passEncoder.SetBindGroup(3, fontFamily.boxAtlas.renderTexture.textureBG);
+        boxTextData.Render(passEncoder, start, end - start);
+      }
+
+      // render shapes (underlines, box drawing)
+      start = shapeIntervals[range.start - firstRow];
+      end = shapeIntervals[range.end - firstRow];
+      if (start != end) {
+        passEncoder.SetPipeline(ctx.pipeline.shapesRPL);
+        shapeData.Render(passEncoder, start, end - start);
+      }
     }
+
+    passEncoder.End();
+    passStart = passEnd;
   }
 
   rectRPD.cColorAttachments[0].view = {};
-  textRPD.cColorAttachments[0].view = {};
-  shapesRPD.cColorAttachments[0].view = {};
+  rectNoClearRPD.cColorAttachments[0].view = {};
+
+  stats.encodeTime += Time() - startTime;
+}
+
+void Renderer::LogStats() const {
+  if (stats.frames == 0) return;
+  auto encodeUs = duration_cast<microseconds>(stats.encodeTime).count();
+  LOG_INFO(
+    "Renderer: {} frames with windows rendered, {:.2f} passes for {:.2f} segments "
+    "and {:.1f} us encoding per frame",
+    stats.frames, double(stats.renderPasses) / stats.frames,
+    double(stats.segments) / stats.frames, double(encodeUs) / stats.frames
+  );
 }
 
 void Renderer::RenderCursorMask(
@@ -436,28 +570,50 @@ void Renderer::RenderCursorMask(
   // if (!cell.text.empty() && cell.text != " ") {
   char32_t charcode = UTF8ToChar32(cell.text);
   const auto& hl = hlTable[cell.hlId];
-  const auto& glyphInfo = fontFamily.GetGlyphInfo(charcode, hl.bold, hl.italic);
-
-  glm::vec2 textQuadPos{
-    0, glyphInfo.boxDrawing ? 0 : fontFamily.DefaultFont().ascender
-  };
-
-  textMaskData.ResetCounts();
-  auto& quad = textMaskData.NextQuad();
-  for (size_t i = 0; i < 4; i++) {
-    quad[i].position = textQuadPos + glyphInfo.localPoss[i];
-    quad[i].regionCoord = glyphInfo.atlasRegion[i];
-  }
-  textMaskData.WriteBuffers();
 
   textMaskRPD.cColorAttachments[0].view = cursor.maskRenderTexture.textureView;
-  RenderPassEncoder passEncoder = commandEncoder.BeginRenderPass(&textMaskRPD);
-  passEncoder.SetPipeline(ctx.pipeline.textMaskRPL);
+  RenderPassEncoder passEncoder = Encoder().BeginRenderPass(&textMaskRPD);
   passEncoder.SetBindGroup(0, cursor.maskRenderTexture.camera.viewProjBG);
-  passEncoder.SetBindGroup(1, fontFamily.textureAtlas.textureSizeBG);
-  passEncoder.SetBindGroup(2, fontFamily.textureAtlas.renderTexture.textureBG);
-  textMaskData.Render(passEncoder);
+
+  if (auto gpuDesc = fontFamily.GpuBoxDesc(charcode)) {
+    // drawn by the shapes shader like in the grid, never in the atlas
+    shapeMaskData.ResetCounts();
+    Rect quadRect{.pos = {0, 0}, .size = fontFamily.DefaultFont().charSize};
+    AddShapeQuad(
+      shapeMaskData, quadRect, {1, 1, 1, 1}, BoxDrawing::gpuShapeType, *gpuDesc
+    );
+    shapeMaskData.WriteBuffers();
+
+    passEncoder.SetPipeline(ctx.pipeline.shapesMaskRPL);
+    passEncoder.SetBindGroup(1, gammaBG);
+    shapeMaskData.Render(passEncoder);
+
+  } else {
+    const auto& glyphInfo = fontFamily.GetGlyphInfo(charcode, hl.bold, hl.italic);
+
+    glm::vec2 textQuadPos{
+      0, glyphInfo.boxDrawing ? 0 : fontFamily.DefaultFont().ascender
+    };
+
+    textMaskData.ResetCounts();
+    auto& quad = textMaskData.NextQuad();
+    for (size_t i = 0; i < 4; i++) {
+      quad[i].position = textQuadPos + glyphInfo.localPoss[i];
+      quad[i].regionCoord = glyphInfo.atlasRegion[i];
+    }
+    textMaskData.WriteBuffers();
+
+    passEncoder.SetPipeline(ctx.pipeline.textMaskRPL);
+    // color glyphs mask by the alpha of the color page
+    const auto& atlas = glyphInfo.color ? *fontFamily.textureAtlas.colorPage
+                        : fontFamily.InBoxAtlas(charcode) ? fontFamily.boxAtlas
+                                                          : fontFamily.textureAtlas;
+    passEncoder.SetBindGroup(1, atlas.textureSizeBG);
+    passEncoder.SetBindGroup(2, atlas.renderTexture.textureBG);
+    textMaskData.Render(passEncoder);
+  }
   passEncoder.End();
+  damaged = true;
 
   // TODO: for some reason this only clears half of the mask for
   // certain font sizes
@@ -465,62 +621,106 @@ void Renderer::RenderCursorMask(
   // } else {
   //   // just clear the texture if there's nothing
   //   textMaskRPD.cColorAttachments[0].view = cursor.maskRenderTexture.textureView;
-  //   RenderPassEncoder passEncoder = commandEncoder.BeginRenderPass(&textMaskRPD);
+  //   RenderPassEncoder passEncoder = Encoder().BeginRenderPass(&textMaskRPD);
   //   passEncoder.End();
   // }
 
   textMaskRPD.cColorAttachments[0].view = {};
 }
 
+wgpu::RenderBundleEncoder Renderer::CreateBundleEncoder(
+  wgpu::TextureFormat format, wgpu::TextureFormat depthStencilFormat
+) {
+  return ctx.device.CreateRenderBundleEncoder(cPtr(RenderBundleEncoderDescriptor{
+    .colorFormatCount = 1,
+    .colorFormats = &format,
+    .depthStencilFormat = depthStencilFormat,
+  }));
+}
+
+void Renderer::UpdateWindowsBundle(
+  std::span<const Win*> windows,
+  const wgpu::RenderPipeline& pipeline,
+  CompositionKey& key,
+  wgpu::RenderBundle& bundle
+) {
+  CompositionKey newKey;
+  newKey.reserve(windows.size());
+  for (const Win* win : windows) {
+    if (win->occluded) continue;
+    newKey.emplace_back(&win->sRenderTexture, win->sRenderTexture.drawVersion);
+  }
+  if (bundle && newKey == key) return;
+  key = std::move(newKey);
+
+  auto bundleEncoder =
+    CreateBundleEncoder(TextureFormat::RGBA8UnormSrgb, TextureFormat::Stencil8);
+  bundleEncoder.SetPipeline(pipeline);
+  bundleEncoder.SetBindGroup(0, finalRenderTexture.camera.viewProjBG);
+  bundleEncoder.SetBindGroup(1, gammaBG);
+  bundleEncoder.SetBindGroup(2, defaultColorBG);
+  for (const Win* win : windows) {
+    if (win->occluded) continue;
+    win->sRenderTexture.Render(bundleEncoder, 3, 4);
+  }
+  bundle = bundleEncoder.Finish();
+}
+
 void Renderer::RenderWindows(
   std::span<const Win*> windows, std::span<const Win*> floatWindows
 ) {
+  damaged = true;
+  UpdateWindowsBundle(
+    windows, ctx.pipeline.textureNoBlendRPL, windowsKey, windowsBundle
+  );
+  UpdateWindowsBundle(
+    floatWindows, ctx.pipeline.textureRPL, floatWindowsKey, floatWindowsBundle
+  );
+
   windowsRPD.cColorAttachments[0].clearValue = linearClearColor;
   windowsRPD.cColorAttachments[0].loadOp = LoadOp::Clear;
   {
-    auto passEncoder = commandEncoder.BeginRenderPass(&windowsRPD);
-    passEncoder.SetPipeline(ctx.pipeline.textureNoBlendRPL);
+    auto passEncoder = Encoder().BeginRenderPass(&windowsRPD);
+    passEncoder.SetViewport(0, 0, uiFbSize.x, uiFbSize.y, 0, 1);
     passEncoder.SetStencilReference(1);
-    passEncoder.SetBindGroup(0, finalRenderTexture.camera.viewProjBG);
-    passEncoder.SetBindGroup(1, gammaBG);
-    passEncoder.SetBindGroup(2, defaultColorBG);
-    for (const Win* win : windows) {
-      win->sRenderTexture.Render(passEncoder, 3);
-    }
+    passEncoder.ExecuteBundles(1, &windowsBundle);
     passEncoder.End();
   }
   windowsRPD.cColorAttachments[0].loadOp = LoadOp::Load;
   {
-    auto passEncoder = commandEncoder.BeginRenderPass(&windowsRPD);
-    passEncoder.SetPipeline(ctx.pipeline.textureRPL);
+    auto passEncoder = Encoder().BeginRenderPass(&windowsRPD);
+    passEncoder.SetViewport(0, 0, uiFbSize.x, uiFbSize.y, 0, 1);
     passEncoder.SetStencilReference(1);
-    passEncoder.SetBindGroup(0, finalRenderTexture.camera.viewProjBG);
-    passEncoder.SetBindGroup(1, gammaBG);
-    passEncoder.SetBindGroup(2, defaultColorBG);
-    for (const Win* win : floatWindows) {
-      win->sRenderTexture.Render(passEncoder, 3);
-    }
+    passEncoder.ExecuteBundles(1, &floatWindowsBundle);
     passEncoder.End();
   }
 }
 
 void Renderer::RenderFinalTexture() {
+  SurfaceTexture surfaceTexture;
+  ctx.surface.GetCurrentTexture(&surfaceTexture);
+  nextTexture = surfaceTexture.texture;
+  nextTextureView = nextTexture.CreateView();
+  damaged = false;
+
   finalRPD.cColorAttachments[0].view = nextTextureView;
   finalRPD.cColorAttachments[0].clearValue = premultClearColor;
 
-  auto passEncoder = commandEncoder.BeginRenderPass(&finalRPD);
-  passEncoder.SetPipeline(ctx.pipeline.textureFinalRPL);
-  passEncoder.SetBindGroup(0, camera.viewProjBG);
-  passEncoder.SetBindGroup(1, gammaBG);
-
-  if (prevFinalRenderTexture.texture) {
-    passEncoder.SetBindGroup(2, prevFinalRenderTexture.textureBG);
-    prevFinalRenderTexture.renderData.Render(passEncoder);
-  } else {
-    passEncoder.SetBindGroup(2, finalRenderTexture.textureBG);
-    finalRenderTexture.renderData.Render(passEncoder);
+  const auto& renderTexture =
+    prevFinalRenderTexture.texture ? prevFinalRenderTexture : finalRenderTexture;
+  if (!finalBundle || finalBundleBG != renderTexture.textureBG.Get()) {
+    auto bundleEncoder = CreateBundleEncoder(ctx.surfaceFormat);
+    bundleEncoder.SetPipeline(ctx.pipeline.textureFinalRPL);
+    bundleEncoder.SetBindGroup(0, camera.viewProjBG);
+    bundleEncoder.SetBindGroup(1, gammaBG);
+    bundleEncoder.SetBindGroup(2, renderTexture.textureBG);
+    renderTexture.renderData.Render(bundleEncoder);
+    finalBundle = bundleEncoder.Finish();
+    finalBundleBG = renderTexture.textureBG.Get();
   }
 
+  auto passEncoder = Encoder().BeginRenderPass(&finalRPD);
+  passEncoder.ExecuteBundles(1, &finalBundle);
   passEncoder.End();
   finalRPD.cColorAttachments[0].view = {};
 }
@@ -541,21 +741,34 @@ void Renderer::RenderCursor(const Cursor& cursor, HlTable& hlTable) {
   }
   cursorData.WriteBuffers();
 
+  // mask bind groups are recreated together when the cursor is resized
+  if (!cursorBundle || cursorBundleBG != cursor.maskPosBG.Get()) {
+    auto bundleEncoder = CreateBundleEncoder(ctx.surfaceFormat);
+    bundleEncoder.SetPipeline(ctx.pipeline.cursorRPL);
+    bundleEncoder.SetBindGroup(0, camera.viewProjBG);
+    bundleEncoder.SetBindGroup(1, cursor.maskRenderTexture.camera.viewProjBG);
+    bundleEncoder.SetBindGroup(2, cursor.maskPosBG);
+    bundleEncoder.SetBindGroup(3, cursor.maskRenderTexture.textureBG);
+    cursorData.Render(bundleEncoder);
+    cursorBundle = bundleEncoder.Finish();
+    cursorBundleBG = cursor.maskPosBG.Get();
+  }
+
   cursorRPD.cColorAttachments[0].view = nextTextureView;
-  RenderPassEncoder passEncoder = commandEncoder.BeginRenderPass(&cursorRPD);
-  passEncoder.SetPipeline(ctx.pipeline.cursorRPL);
-  passEncoder.SetBindGroup(0, camera.viewProjBG);
-  passEncoder.SetBindGroup(1, cursor.maskRenderTexture.camera.viewProjBG);
-  passEncoder.SetBindGroup(2, cursor.maskPosBG);
-  passEncoder.SetBindGroup(3, cursor.maskRenderTexture.textureBG);
-  cursorData.Render(passEncoder);
+  RenderPassEncoder passEncoder = Encoder().BeginRenderPass(&cursorRPD);
+  passEncoder.ExecuteBundles(1, &cursorBundle);
   passEncoder.End();
   cursorRPD.cColorAttachments[0].view = {};
 }
 
-void Renderer::End() {
-  auto commandBuffer = commandEncoder.Finish();
-  ctx.queue.Submit(1, &commandBuffer);
+bool Renderer::End() {
+  if (commandEncoder) {
+    auto commandBuffer = commandEncoder.Finish();
+    ctx.queue.Submit(1, &commandBuffer);
+    commandEncoder = {};
+  }
+  bool present = nextTexture != nullptr;
   nextTexture = {};
   nextTextureView = {};
+  return present;
 }
@@ -11,7 +11,11 @@
 #include "gfx/quad.hpp"
 #include "gfx/render_texture.hpp"
 #include "webgpu_tools/utils/webgpu.hpp"
+#include <chrono>
+#include <cstdint>
 #include <span>
+#include <utility>
+#include <vector>
 
 struct Renderer {
   // color stuff
@@ -28,6 +32,7 @@ struct Renderer {
   wgpu::BindGroup defaultColorBG;
 
   // shared
+  // created on first use, frames without damage record nothing
   wgpu::CommandEncoder commandEncoder;
   wgpu::Texture nextTexture;
   wgpu::TextureView nextTextureView;
@@ -37,35 +42,79 @@ struct Renderer {
   // double buffer, so resizing doesn't flicker
   RenderTexture prevFinalRenderTexture;
 
-  // rect (background)
+  // final texture and stencil are allocated in buckets, live resizing reuses them
+  // while the ui fits. they get a bucket of headroom when reallocated during a
+  // resize, and shrink to fit once it settles
+  static constexpr float targetBucket = 256;
+  glm::vec2 targetFbSize{};
+  float targetDpiScale = 0;
+  glm::vec2 uiFbSize{}; // used region of the targets
+
+  // window segments, backgrounds, text and shapes share a pass
   wgpu::utils::RenderPassDescriptor rectRPD;
   wgpu::utils::RenderPassDescriptor rectNoClearRPD;
 
-  // text and shapes
-  wgpu::utils::RenderPassDescriptor textRPD;
-  wgpu::utils::RenderPassDescriptor shapesRPD;
-
-  // text mask
+  // text mask, shader drawn box chars go to shapeMaskData
   QuadRenderData<TextMaskQuadVertex> textMaskData;
+  QuadRenderData<ShapeQuadVertex> shapeMaskData;
   wgpu::utils::RenderPassDescriptor textMaskRPD;
 
   // windows
   wgpu::utils::RenderPassDescriptor windowsRPD;
+  // composition, final and cursor draws are replayed from render bundles, and
+  // recorded again only when what they draw changes. composition is keyed by the
+  // draw versions of the composited windows
+  using CompositionKey = std::vector<std::pair<const void*, uint64_t>>;
+  CompositionKey windowsKey;
+  CompositionKey floatWindowsKey;
+  wgpu::RenderBundle windowsBundle;
+  wgpu::RenderBundle floatWindowsBundle;
 
   // final texture
   wgpu::utils::RenderPassDescriptor finalRPD;
+  wgpu::RenderBundle finalBundle;
+  WGPUBindGroup finalBundleBG = nullptr;
 
   // cursor
   QuadRenderData<CursorQuadVertex> cursorData;
   wgpu::utils::RenderPassDescriptor cursorRPD;
+  wgpu::RenderBundle cursorBundle;
+  WGPUBindGroup cursorBundleBG = nullptr;
+
+  // the surface is only redrawn and presented when the composite, colors, size or
+  // cursor changed since the last present
+  bool damaged = true;
+  struct CursorFrame {
+    bool visible;
+    glm::vec2 pos;
+    Region corners;
+    int attrId;
+    bool operator==(const CursorFrame&) const = default;
+  };
+  CursorFrame presentedCursor{};
+
+  // window rendering cost, summed over frames that render windows
+  struct Stats {
+    size_t frames = 0;
+    size_t segments = 0; // render textures drawn to, a pass each before merging
+    size_t renderPasses = 0;
+    std::chrono::nanoseconds encodeTime{};
+  };
+  Stats stats;
+  bool windowsRendered = false; // this frame
 
   Renderer() = default;
   Renderer(const SizeHandler& sizes);
 
   void Resize(const SizeHandler& sizes);
+  // returns true if reallocated, windows need to be composited again
+  bool ShrinkTargets(const SizeHandler& sizes);
   void SetColors(const glm::vec4& color, float gamma);
 
   void Begin();
+  wgpu::CommandEncoder& Encoder();
+  // marks damage if the cursor looks different from the last present
+  void UpdateCursorDamage(const Cursor& cursor);
   // void RenderShapes(FontFamily& fontFamily);
   void RenderToWindow(Win& win, FontFamily& fontFamily, HlTable& hlTable);
   void RenderCursorMask(
@@ -74,5 +123,22 @@ struct Renderer {
   void RenderWindows(std::span<const Win*> windows, std::span<const Win*> floatWindows);
   void RenderFinalTexture();
   void RenderCursor(const Cursor& cursor, HlTable& hlTable);
-  void End();
+  // returns true if a surface texture was drawn and should be presented
+  bool End();
+  void LogStats() const;
+
+private:
+  static glm::vec2 BucketSize(glm::vec2 fbSize);
+  wgpu::RenderBundleEncoder CreateBundleEncoder(
+    wgpu::TextureFormat format,
+    wgpu::TextureFormat depthStencilFormat = wgpu::TextureFormat::Undefined
+  );
+  void UpdateWindowsBundle(
+    std::span<const Win*> windows,
+    const wgpu::RenderPipeline& pipeline,
+    CompositionKey& key,
+    wgpu::RenderBundle& bundle
+  );
+  void AllocateTargets(glm::vec2 fbSize, float dpiScale);
+  void SetFinalRegion(const SizeHandler& sizes);
 };
@@ -10,7 +10,8 @@ inline void AddShapeQuad(
   QuadRenderData<ShapeQuadVertex, Dynamic>& data,
   const Rect& rect,
   const glm::vec4& color,
-  uint32_t shapeType
+  uint32_t shapeType,
+  uint32_t shapeDesc = 0
 ) {
   auto quadPoss = rect.Region();
   auto quadSize = rect.size;
@@ -23,5 +24,6 @@ inline void AddShapeQuad(
     quad[i].coord = coords[i];
     quad[i].color = color;
     quad[i].shapeType = shapeType;
+    quad[i].shapeDesc = shapeDesc;
   }
 }
@@ -29,6 +29,13 @@ TextureAtlas::TextureAtlas(float _glyphSize, float _dpiScale)
   renderTexture = RenderTexture(textureSize, dpiScale, TextureFormat::RGBA8Unorm);
 }
 
+TextureAtlas& TextureAtlas::ColorPage() {
+  if (!colorPage) {
+    colorPage = std::make_unique<TextureAtlas>(trueGlyphSize / dpiScale, dpiScale);
+  }
+  return *colorPage;
+}
+
 void TextureAtlas::Resize() {
   int heightIncrease = trueGlyphSize * 3;
   bufferSize.y += heightIncrease;
@@ -42,6 +49,7 @@ void TextureAtlas::Resize() {
 }
 
 void TextureAtlas::Update() {
+  if (colorPage) colorPage->Update();
   if (!dirty) return;
 
   if (resized) {
@@ -4,6 +4,8 @@
 #include "utils/region.hpp"
 #include "webgpu/webgpu_cpp.h"
 #include <cstdint>
+#include <memory>
+#include <type_traits>
 #include <vector>
 #include <mdspan>
 
@@ -36,53 +38,76 @@ struct TextureAtlas {
   RenderTexture renderTexture;
   bool resized = false;
 
+  // premultiplied rgba glyphs (color emoji), drawn with a separate pipeline.
+  // only created when a color glyph is added.
+  std::unique_ptr<TextureAtlas> colorPage;
+
   TextureAtlas() = default;
   TextureAtlas(float glyphSize, float dpiScale);
 
+  TextureAtlas& ColorPage();
+
   // Adds data to texture atlas, and returns the region where the data was added.
   // Region coordinates is relative to textureSize.
-  template <class LayoutPolicy>
-  Region AddGlyph(std::mdspan<uint8_t, std::dextents<size_t, 2>, LayoutPolicy> glyphData);
+  // Color elements are copied as is, other elements are coverage in alpha.
+  // sdf data is marked with rgb = 0 and padded so that filtering stays inside it.
+  template <class ElementType, class LayoutPolicy>
+  Region AddGlyph(
+    std::mdspan<ElementType, std::dextents<size_t, 2>, LayoutPolicy> glyphData,
+    bool sdf = false
+  );
   // Resize cpu side data and sizes
   void Resize();
-  // Resize gpu side data and update bind group
+  // Resize gpu side data and update bind group, including the color page
   void Update();
 };
 
-template <class LayoutPolicy>
+template <class ElementType, class LayoutPolicy>
 Region TextureAtlas::AddGlyph(
-  std::mdspan<uint8_t, std::dextents<size_t, 2>, LayoutPolicy> glyphData
+  std::mdspan<ElementType, std::dextents<size_t, 2>, LayoutPolicy> glyphData,
+  bool sdf
 ) {
+  // empty border around sdf data, zero distance is outside the glyph
+  size_t padding = sdf ? 1 : 0;
+  size_t width = glyphData.extent(1) + padding * 2;
+  size_t height = glyphData.extent(0) + padding * 2;
+
   // check if current row is full
   // if so, move to next row
-  if (currentPos.x + glyphData.extent(1) > bufferSize.x) {
+  if (currentPos.x + width > bufferSize.x) {
     currentPos.x = 0;
     currentPos.y += currMaxHeight;
     currMaxHeight = 0;
   }
-  if (currentPos.y + glyphData.extent(0) > bufferSize.y) {
+  while (currentPos.y + height > bufferSize.y) {
     Resize();
   }
 
   // fill data
+  glm::uvec2 dataPos = currentPos + glm::uvec2(padding);
+  uint8_t rgb = sdf ? 0 : 255;
   for (size_t row = 0; row < glyphData.extent(0); row++) {
     for (size_t col = 0; col < glyphData.extent(1); col++) {
-      Color& dest = data[currentPos.y + row, currentPos.x + col];
-      dest.r = 255;
-      dest.g = 255;
-      dest.b = 255;
-      dest.a = glyphData[row, col];
+      Color& dest = data[dataPos.y + row, dataPos.x + col];
+      if constexpr (std::is_same_v<std::remove_cv_t<ElementType>, Color>) {
+        dest = glyphData[row, col];
+      } else {
+        dest.r = rgb;
+        dest.g = rgb;
+        dest.b = rgb;
+        dest.a = glyphData[row, col];
+      }
     }
   }
   dirty = true;
 
   // calculate region
-  auto regionPos = glm::vec2(currentPos) / dpiScale;
+  auto regionPos = glm::vec2(dataPos) / dpiScale;
   auto regionSize = glm::vec2(glyphData.extent(1), glyphData.extent(0)) / dpiScale;
 
   // advance current position
-  currentPos.x += glyphData.extent(1);
-  currMaxHeight = std::max((size_t)currMaxHeight, glyphData.extent(0));
+  currentPos.x += width;
+  currMaxHeight = std::max((size_t)currMaxHeight, height);
 
   return MakeRegion(regionPos, regionSize);
 }
@@ -0,0 +1,152 @@
+#include "tile_atlas.hpp"
+#include "gfx/instance.hpp"
+#include "utils/logger.hpp"
+#include "webgpu_tools/utils/webgpu.hpp"
+#include <algorithm>
+
+using namespace wgpu;
+
+TileAtlas::Tile::Tile(std::shared_ptr<Page> _page, glm::uvec2 _pos, glm::uvec2 _size)
+    : page(std::move(_page)), pos(_pos), size(_size) {
+}
+
+TileAtlas::Tile& TileAtlas::Tile::operator=(Tile&& other) {
+  if (this != &other) {
+    Release();
+    page = std::move(other.page);
+    pos = other.pos;
+    size = other.size;
+  }
+  return *this;
+}
+
+TileAtlas::Tile::~Tile() {
+  Release();
+}
+
+void TileAtlas::Tile::Release() {
+  if (page == nullptr) return;
+  tileAtlas.Free(*page, pos);
+  page = nullptr;
+}
+
+std::optional<TileAtlas::Tile>
+TileAtlas::AllocateInPage(const std::shared_ptr<Page>& page, glm::uvec2 size) {
+  auto takeSlot = [&](Shelf& shelf, size_t slotIndex) {
+    auto& slot = shelf.slots[slotIndex];
+    uint32_t x = slot.x;
+    if (slot.width > size.x) {
+      Slot rest{.x = x + size.x, .width = slot.width - size.x, .used = false};
+      slot.width = size.x;
+      shelf.slots.insert(shelf.slots.begin() + slotIndex + 1, rest);
+    }
+    shelf.slots[slotIndex].used = true;
+    page->numTiles++;
+    return Tile(page, {x, shelf.y}, size);
+  };
+
+  // shelves a bit taller than the tile are fine, fully free shelves of any
+  // larger height as well
+  for (auto& shelf : page->shelves) {
+    if (shelf.height < size.y) continue;
+    bool empty = shelf.slots.size() == 1 && !shelf.slots[0].used;
+    if (!empty && shelf.height - size.y > size.y / 4) continue;
+
+    for (size_t i = 0; i < shelf.slots.size(); i++) {
+      const auto& slot = shelf.slots[i];
+      if (!slot.used && slot.width >= size.x) {
+        return takeSlot(shelf, i);
+      }
+    }
+  }
+
+  if (page->usedHeight + size.y > pageSize.y) return std::nullopt;
+
+  auto& shelf = page->shelves.emplace_back(Shelf{
+    .y = page->usedHeight,
+    .height = size.y,
+    .slots = {{.x = 0, .width = pageSize.x, .used = false}},
+  });
+  page->usedHeight += size.y;
+  return takeSlot(shelf, 0);
+}
+
+std::optional<TileAtlas::Tile>
+TileAtlas::Allocate(glm::uvec2 size, wgpu::TextureFormat format) {
+  if (size.x == 0 || size.y == 0 || size.x > pageSize.x || size.y > pageSize.y) {
+    return std::nullopt;
+  }
+
+  for (const auto& page : pages) {
+    if (page->format != format) continue;
+    if (auto tile = AllocateInPage(page, size)) return tile;
+  }
+
+  auto page = std::make_shared<Page>();
+  page->format = format;
+  page->texture =
+    utils::CreateRenderTexture(ctx.device, {glm::vec2(pageSize), format});
+  page->textureView = page->texture.CreateView();
+
+  auto textureSampler = ctx.device.CreateSampler(
+    cPtr(SamplerDescriptor{
+      .addressModeU = AddressMode::ClampToEdge,
+      .addressModeV = AddressMode::ClampToEdge,
+      .magFilter = FilterMode::Nearest,
+      .minFilter = FilterMode::Nearest,
+    })
+  );
+  page->textureBG = utils::MakeBindGroup(
+    ctx.device, ctx.pipeline.textureBGL,
+    {
+      {0, page->textureView},
+      {1, textureSampler},
+    }
+  );
+
+  pages.push_back(page);
+  LOG_INFO("TileAtlas: {} pages", pages.size());
+  return AllocateInPage(page, size);
+}
+
+void TileAtlas::Free(Page& page, glm::uvec2 pos) {
+  auto shelfIt = std::ranges::find_if(page.shelves, [&](const Shelf& shelf) {
+    return shelf.y == pos.y;
+  });
+  if (shelfIt == page.shelves.end()) return;
+
+  auto& slots = shelfIt->slots;
+  auto slotIt = std::ranges::find_if(slots, [&](const Slot& slot) {
+    return slot.x == pos.x && slot.used;
+  });
+  if (slotIt == slots.end()) return;
+
+  // merge with free neighbours
+  slotIt->used = false;
+  if (auto next = slotIt + 1; next != slots.end() && !next->used) {
+    slotIt->width += next->width;
+    slots.erase(next);
+  }
+  if (slotIt != slots.begin()) {
+    if (auto prev = slotIt - 1; !prev->used) {
+      prev->width += slotIt->width;
+      slots.erase(slotIt);
+    }
+  }
+  page.numTiles--;
+
+  // give back the height of empty shelves at the bottom
+  while (!page.shelves.empty() && page.shelves.back().slots.size() == 1 &&
+         !page.shelves.back().slots[0].used) {
+    page.usedHeight = page.shelves.back().y;
+    page.shelves.pop_back();
+  }
+
+  if (page.numTiles == 0) {
+    std::erase_if(pages, [&](const auto& p) { return p.get() == &page; });
+  }
+}
+
+void TileAtlas::Clear() {
+  pages.clear();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "glm/ext/vector_uint2.hpp"
+#include "webgpu/webgpu_cpp.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Large textures shared by the segments of all windows, so that composition
+// doesn't switch textures per segment.
+// Each page is split into shelves, tiles of similar height are packed left to
+// right in a shelf. Render thread only.
+struct TileAtlas {
+  static constexpr glm::uvec2 pageSize = {4096, 2048};
+
+  struct Slot {
+    uint32_t x;
+    uint32_t width;
+    bool used;
+  };
+
+  struct Shelf {
+    uint32_t y;
+    uint32_t height;
+    std::vector<Slot> slots; // sorted by x, covers the page width
+  };
+
+  struct Page {
+    wgpu::TextureFormat format;
+    wgpu::Texture texture;
+    wgpu::TextureView textureView;
+    wgpu::BindGroup textureBG;
+
+    std::vector<Shelf> shelves; // sorted by y
+    uint32_t usedHeight = 0;
+    int numTiles = 0;
+  };
+
+  // region of a page in texels, freed on destruction
+  struct Tile {
+    std::shared_ptr<Page> page;
+    glm::uvec2 pos{};
+    glm::uvec2 size{};
+
+    Tile() = default;
+    Tile(std::shared_ptr<Page> page, glm::uvec2 pos, glm::uvec2 size);
+    Tile(Tile&&) = default;
+    Tile& operator=(Tile&& other);
+    ~Tile();
+
+    void Release();
+  };
+
+  std::vector<std::shared_ptr<Page>> pages;
+
+  // returns nullopt if size doesn't fit in a page
+  std::optional<Tile> Allocate(glm::uvec2 size, wgpu::TextureFormat format);
+  void Free(Page& page, glm::uvec2 pos);
+  // drops the atlas reference to all pages, call before the device is gone
+  void Clear();
+
+private:
+  std::optional<Tile> AllocateInPage(
+    const std::shared_ptr<Page>& page, glm::uvec2 size
+  );
+};
+
+inline TileAtlas tileAtlas;
@@ -9,10 +9,12 @@
 #include "editor/highlight.hpp"
 #include "editor/state.hpp"
 #include "editor/font.hpp"
+#include "gfx/glyph_cache.hpp"
 #include "gfx/instance.hpp"
 #include "gfx/render_texture.hpp"
 #include "gfx/renderer.hpp"
 #include "glm/ext/vector_float2.hpp"
+#include "glm/ext/vector_int2.hpp"
 #include "glm/gtx/string_cast.hpp"
 #include "nvim/events/ui.hpp"
 #include "nvim/events/user.hpp"
@@ -24,6 +26,7 @@
 
 #include <boost/core/demangle.hpp>
 #include <algorithm>
+#include <optional>
 #include <span>
 #include <vector>
 #include <atomic>
@@ -86,6 +89,14 @@ int main() {
       bool idle = false;
       float idleElasped = 0;
 
+      // live resize: nvim resizes are coalesced to one per interval, and render
+      // targets shrink to fit once the window stops changing size
+      constexpr float uiResizeInterval = 0.05;
+      constexpr float resizeSettleTime = 0.5;
+      std::optional<glm::ivec2> pendingUiSize;
+      float uiResizeElasped = uiResizeInterval;
+      float resizeSettleElasped = -1; // negative when not resizing
+
       Clock clock;
       // Timer timer(10);
 
@@ -160,6 +171,7 @@ int main() {
             case SDL_EVENT_WINDOW_EXPOSED:
               // LOG_INFO("window exposed");
               windowOccluded = false;
+              renderer.damaged = true;
               break;
             case SDL_EVENT_WINDOW_OCCLUDED:
               // LOG_INFO("window occluded");
@@ -180,6 +192,7 @@ int main() {
                 break;
               case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED: {
                 window.fbSize = {event.window.data1, event.window.data2};
+                resizeSettleElasped = 0;
                 // LOG_INFO("pixel size changed, {} {}", window.fbSize.x, window.fbSize.y);
 
                 float prevDpiScale = window.dpiScale;
@@ -187,31 +200,34 @@ int main() {
                 bool dpiChanged = prevDpiScale != window.dpiScale;
 
                 if (dpiChanged) {
-                  editorState->fontFamily.ChangeDpiScale(window.dpiScale);
+                  fontFamilyRegistry.ChangeDpiScale(
+                    editorState->fontFamily, window.dpiScale
+                  );
+                  editorState->fontFamily->Prewarm(GetVisibleGlyphs(*editorState));
                 }
 
                 auto uiFbSize = sizes.uiFbSize;
                 sizes.UpdateSizes(
                   window.size, window.dpiScale,
-                  editorState->fontFamily.DefaultFont().charSize,
+                  editorState->fontFamily->DefaultFont().charSize,
                   options->margins
                 );
 
                 if (dpiChanged) {
                   editorState->cursor.Resize(sizes.charSize, sizes.dpiScale);
-                  // force nvim to resend all events to update dpiScale
-                  nvim->UiTryResize(sizes.uiWidth + 1, sizes.uiHeight);
-                  editorState->winManager.sizes = sizes;
+                  editorState->cursor.dirty = true;
+                  editorState->winManager.UpdateSizes(sizes);
                 }
 
                 sdl::Window::_ctx.Resize(sizes.fbSize);
 
                 if (uiFbSize == sizes.uiFbSize) {
                   renderer.camera.Resize(sizes.size);
+                  renderer.damaged = true;
 
                 } else {
                   renderer.Resize(sizes);
-                  nvim->UiTryResize(sizes.uiWidth, sizes.uiHeight);
+                  pendingUiSize = glm::ivec2(sizes.uiWidth, sizes.uiHeight);
                 }
 
                 // if (resizing) {
@@ -224,6 +240,23 @@ int main() {
           resizeEvents.Pop();
         }
 
+        uiResizeElasped += dt;
+        if (pendingUiSize && uiResizeElasped >= uiResizeInterval) {
+          nvim->UiTryResize(pendingUiSize->x, pendingUiSize->y);
+          pendingUiSize.reset();
+          uiResizeElasped = 0;
+        }
+
+        if (resizeSettleElasped >= 0) {
+          resizeSettleElasped += dt;
+          if (resizeSettleElasped >= resizeSettleTime) {
+            resizeSettleElasped = -1;
+            if (renderer.ShrinkTargets(sizes)) {
+              editorState->winManager.dirty = true;
+            }
+          }
+        }
+
         // update --------------------------------------------
         editorState->winManager.UpdateScrolling(dt);
 
@@ -277,16 +310,19 @@ int main() {
         // render ----------------------------------------------
         auto color = GetDefaultBackground(editorState->hlTable);
         renderer.SetColors(color, options->gamma);
+        renderTexturePool.SetBudget(size_t(options->texturePoolSize * (1 << 20)));
 
         renderer.Begin();
 
         bool mainWindowRendered = false;
         bool renderWindows = false;
+        editorState->winManager.UpdateOcclusion();
         for (auto& [id, win] : editorState->winManager.windows) {
-          if (win.grid.dirty) {
+          // covered windows stay dirty until uncovered
+          if (win.grid.dirty && !win.occluded) {
             if (win.id == 1) mainWindowRendered = true;
             renderer.RenderToWindow(
-              win, editorState->fontFamily, editorState->hlTable
+              win, *editorState->fontFamily, editorState->hlTable
             );
             win.grid.dirty = false;
             renderWindows = true;
@@ -295,41 +331,16 @@ int main() {
 
         if (editorState->cursor.dirty && currWin != nullptr) {
           renderer.RenderCursorMask(
-            *currWin, editorState->cursor, editorState->fontFamily,
+            *currWin, editorState->cursor, *editorState->fontFamily,
             editorState->hlTable
           );
           editorState->cursor.dirty = false;
         }
 
         if (renderWindows || editorState->winManager.dirty || session->reattached) {
-          editorState->winManager.dirty = false;
-
-          std::vector<const Win*> windows;
-          if (const auto* msgWin = editorState->winManager.GetMsgWin()) {
-            windows.push_back(msgWin);
-          }
-          std::vector<const Win*> floatWindows;
-          for (auto& [id, win] : editorState->winManager.windows) {
-            if (id == 1 || id == editorState->winManager.msgWinId || win.hidden) {
-              continue;
-            }
-            if (win.IsFloating()) {
-              floatWindows.push_back(&win);
-            } else {
-              windows.push_back(&win);
-            }
-          }
-          if (auto winIt = editorState->winManager.windows.find(1);
-              winIt != editorState->winManager.windows.end()) {
-            windows.push_back(&winIt->second);
-          }
-
-          // sort floating windows by zindex
-          std::ranges::sort(floatWindows, [](const Win* win, const Win* other) {
-            return win->floatData->zindex > other->floatData->zindex;
-          });
-
-          renderer.RenderWindows(windows, floatWindows);
+          auto& winManager = editorState->winManager;
+          winManager.dirty = false;
+          renderer.RenderWindows(winManager.splitOrder, winManager.floatOrder);
           // reset reattached flag after rendering
           session->reattached = false;
         }
@@ -337,17 +348,22 @@ int main() {
         // switch to current texture only after rendering to it
         if (renderer.prevFinalRenderTexture.texture && mainWindowRendered) {
           renderer.prevFinalRenderTexture = {};
+          renderer.damaged = true;
         }
 
-        renderer.RenderFinalTexture();
+        // frames that change nothing on screen are not drawn or presented
+        renderer.UpdateCursorDamage(editorState->cursor);
+        if (renderer.damaged) {
+          renderer.RenderFinalTexture();
 
-        if (editorState->cursor.ShouldRender()) {
-          renderer.RenderCursor(
-            editorState->cursor, editorState->hlTable
-          );
+          if (editorState->cursor.ShouldRender()) {
+            renderer.RenderCursor(
+              editorState->cursor, editorState->hlTable
+            );
+          }
         }
 
-        renderer.End();
+        bool present = renderer.End();
         // if (resizing && resized1) {
         //   ctx.queue.OnSubmittedWorkDone(
         //     wgpu::CallbackMode::AllowProcessEvents,
@@ -362,7 +378,7 @@ int main() {
         //     std::this_thread::sleep_for(1ms);
         //   }
         // } else {
-        ctx.surface.Present();
+        if (present) ctx.surface.Present();
         ctx.device.Tick();
         // }
 
@@ -371,6 +387,8 @@ int main() {
         // auto avgDuration = duration_cast<microseconds>(timer.GetAverageDuration());
         // std::cout << '\r' << avgDuration << std::string(10, ' ') << std::flush;
       }
+
+      renderer.LogStats();
     });
 
     // event loop --------------------------------
@@ -465,6 +483,11 @@ int main() {
     LOG_ERR("Exiting...");
   }
 
+  renderTexturePool.Clear();
+  tileAtlas.Clear();
+  // fonts are gone with the sessions, finish writing their glyph caches
+  GlyphCache::WaitForFlushes();
+
   // destructors cleans up window and font before quitting sdl and freetype
   // FtDone();
   // SDL_Quit();
@@ -4,6 +4,7 @@
 #include "utils/logger.hpp"
 #include <algorithm>
 #include <stdexcept>
+#include <utility>
 #include <ranges>
 #include "glm/gtx/string_cast.hpp"
 
@@ -83,14 +84,17 @@ int SessionManager::SessionNew(const SessionNewOpts& opts) {
     options.margins.top += Options::titlebarHeight;
   }
 
-  auto fontFamilyResult = FontFamily::FromGuifont(guifont, linespace, window.dpiScale);
+  auto fontFamilyResult = fontFamilyRegistry.FromGuifont(
+    guifont, linespace, window.dpiScale, options.sdfFonts, options.gpuBoxDrawing
+  );
   if (!fontFamilyResult) {
     throw std::runtime_error("Invalid guifont: " + fontFamilyResult.error());
   }
   editorState.fontFamily = std::move(*fontFamilyResult);
+  PrewarmFontSizes(session);
 
   sizes.UpdateSizes(
-    window.size, window.dpiScale, editorState.fontFamily.DefaultFont().charSize,
+    window.size, window.dpiScale, editorState.fontFamily->DefaultFont().charSize,
     options.margins
   );
 
@@ -219,7 +223,8 @@ void SessionManager::FontSizeChange(float delta, bool all) {
   if (all) {
     auto* curr = CurrSession();
     for (auto& [_, session] : sessions) {
-      session.editorState.fontFamily.ChangeSize(delta);
+      fontFamilyRegistry.ChangeSize(session.editorState.fontFamily, delta);
+      PrewarmFontSizes(session);
       if (curr == &session) {
         UpdateSessionSizes(session);
       }
@@ -227,7 +232,8 @@ void SessionManager::FontSizeChange(float delta, bool all) {
 
   } else {
     if (auto* session = CurrSession()) {
-      session->editorState.fontFamily.ChangeSize(delta);
+      fontFamilyRegistry.ChangeSize(session->editorState.fontFamily, delta);
+      PrewarmFontSizes(*session);
       UpdateSessionSizes(*session);
     }
   }
@@ -237,7 +243,8 @@ void SessionManager::FontSizeReset(bool all) {
   if (all) {
     auto* curr = CurrSession();
     for (auto& [_, session] : sessions) {
-      session.editorState.fontFamily.ResetSize();
+      fontFamilyRegistry.ResetSize(session.editorState.fontFamily);
+      PrewarmFontSizes(session);
       if (curr == &session) {
         UpdateSessionSizes(session);
       }
@@ -245,7 +252,8 @@ void SessionManager::FontSizeReset(bool all) {
 
   } else {
     if (auto* session = CurrSession()) {
-      session->editorState.fontFamily.ResetSize();
+      fontFamilyRegistry.ResetSize(session->editorState.fontFamily);
+      PrewarmFontSizes(*session);
       UpdateSessionSizes(*session);
     }
   }
@@ -253,15 +261,22 @@ void SessionManager::FontSizeReset(bool all) {
 
 void SessionManager::UpdateSessionSizes(SessionState& session) {
   sizes.UpdateSizes(
-    window.size, window.dpiScale, session.editorState.fontFamily.DefaultFont().charSize,
-    session.options.margins
+    window.size, window.dpiScale,
+    session.editorState.fontFamily->DefaultFont().charSize, session.options.margins
   );
   renderer.Resize(sizes);
-  session.editorState.winManager.sizes = sizes;
+  session.editorState.winManager.UpdateSizes(sizes);
   session.editorState.cursor.Resize(sizes.charSize, sizes.dpiScale);
   session.nvim.UiTryResize(sizes.uiWidth, sizes.uiHeight);
 }
 
+void SessionManager::PrewarmFontSizes(SessionState& session) {
+  auto& editorState = session.editorState;
+  auto glyphs = GetVisibleGlyphs(editorState);
+  editorState.fontFamily->Prewarm(glyphs);
+  editorState.fontFamily->PrewarmCachedSizes(std::move(glyphs));
+}
+
 // void SessionManager::LoadSessions(std::string_view filename) {
 //   std::ifstream file(filename);
 //   std::string line;
@@ -72,6 +72,9 @@ public:
 
 private:
   void UpdateSessionSizes(SessionState& session);
+  // rasterize common and visible glyphs into the session's current font size,
+  // then visible glyphs into its cached sizes in the background
+  void PrewarmFontSizes(SessionState& session);
 
   // void LoadSessions(std::string_view filename);
   // void SaveSessions(std::string_view filename);
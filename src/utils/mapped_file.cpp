@@ -0,0 +1,84 @@
+#include "mapped_file.hpp"
+#include "SDL3/SDL_platform_defines.h"
+#include <utility>
+
+#if defined(SDL_PLATFORM_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+MappedFile::MappedFile(const std::string& path) {
+  HANDLE file = CreateFileA(
+    path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+  );
+  if (file == INVALID_HANDLE_VALUE) return;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+    CloseHandle(file);
+    return;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) return;
+
+  // view stays valid after the mapping handle is closed
+  void* addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (addr == nullptr) return;
+
+  data = static_cast<const uint8_t*>(addr);
+  size = fileSize.QuadPart;
+}
+
+static void Unmap(const uint8_t* data, size_t) {
+  UnmapViewOfFile(data);
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return;
+  }
+
+  void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // mapping stays valid after the descriptor is closed
+  close(fd);
+  if (addr == MAP_FAILED) return;
+
+  data = static_cast<const uint8_t*>(addr);
+  size = st.st_size;
+}
+
+static void Unmap(const uint8_t* data, size_t size) {
+  munmap(const_cast<uint8_t*>(data), size);
+}
+#endif
+
+MappedFile::~MappedFile() {
+  if (data) Unmap(data, size);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this != &other) {
+    if (data) Unmap(data, size);
+    data = std::exchange(other.data, nullptr);
+    size = std::exchange(other.size, 0);
+  }
+  return *this;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+// read-only memory mapped file
+// data is nullptr if the file couldn't be opened or mapped
+struct MappedFile {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+
+  MappedFile() = default;
+  MappedFile(const std::string& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  explicit operator bool() const {
+    return data != nullptr;
+  }
+
+  std::span<const uint8_t> Span() const {
+    return {data, size};
+  }
+};
@@ -1,6 +1,7 @@
 #include "unicode.hpp"
 #include "utf8/checked.h"
 #include "utils/logger.hpp"
+#include <iterator>
 
 std::string Char32ToUTF8(char32_t unicode) {
   std::string utf8String;
@@ -13,6 +14,25 @@ std::string Char32ToUTF8(char32_t unicode) {
   return utf8String;
 }
 
+std::u32string UTF8ToChar32String(std::string_view utf8String) {
+  std::u32string result;
+  try {
+    utf8::utf8to32(utf8String.begin(), utf8String.end(), std::back_inserter(result));
+  } catch (const std::exception& e) {
+    LOG_ERR("UTF8ToChar32String: {}, {}", e.what(), utf8String);
+    result.clear();
+  }
+  return result;
+}
+
+bool IsCombiningMark(char32_t unicode) {
+  return (unicode >= 0x0300 && unicode <= 0x036F) || // combining diacritical marks
+         (unicode >= 0x1AB0 && unicode <= 0x1AFF) || // extended
+         (unicode >= 0x1DC0 && unicode <= 0x1DFF) || // supplement
+         (unicode >= 0x20D0 && unicode <= 0x20FF) || // for symbols
+         (unicode >= 0xFE20 && unicode <= 0xFE2F);   // half marks
+}
+
 char32_t UTF8ToChar32(const std::string& utf8String) {
   auto it = utf8String.begin();
   try {
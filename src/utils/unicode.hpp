@@ -1,7 +1,14 @@
 #pragma once 
 
 #include <string>
+#include <string_view>
 
 std::string Char32ToUTF8(char32_t unicode);
 
 char32_t UTF8ToChar32(const std::string& utf8String);
+
+// all codepoints, empty on invalid utf8
+std::u32string UTF8ToChar32String(std::string_view utf8String);
+
+// combining marks that are drawn over the previous char in the same cell
+bool IsCombiningMark(char32_t unicode);
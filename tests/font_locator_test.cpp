@@ -0,0 +1,62 @@
+// resolves the bundled Hack fonts through the fontconfig locator
+#include "app/path.hpp"
+#include "gfx/font/locator.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+
+#include <fontconfig/fontconfig.h>
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void Check(bool condition, std::string_view what) {
+  if (condition) return;
+  std::cerr << "FAILED: " << what << "\n";
+  failures++;
+}
+
+static void CheckResolves(
+  const std::string& name, bool bold, bool italic, const std::string& fileName
+) {
+  auto path = GetFontPathFromName({.name = name, .bold = bold, .italic = italic});
+  Check(
+    fs::path(path).filename() == fileName,
+    std::format(
+      "{} bold={} italic={} -> '{}', expected {}", name, bold, italic, path, fileName
+    )
+  );
+}
+
+int main() {
+  auto tmpDir = fs::temp_directory_path() / "neogurt_font_locator_test";
+  fs::remove_all(tmpDir);
+  cacheDir = tmpDir.string();
+
+  // only the bundled fonts, so results don't depend on installed fonts
+  FcConfig* config = FcConfigCreate();
+  FcConfigAppFontAddDir(config, (const FcChar8*)(ROOT_DIR "/res/Hack"));
+  FcConfigSetCurrent(config);
+
+  CheckResolves("Hack Nerd Font Mono", false, false, "HackNerdFontMono-Regular.ttf");
+  CheckResolves("Hack Nerd Font Mono", true, false, "HackNerdFontMono-Bold.ttf");
+  CheckResolves("Hack Nerd Font Mono", false, true, "HackNerdFontMono-Italic.ttf");
+  CheckResolves("Hack Nerd Font Mono", true, true, "HackNerdFontMono-BoldItalic.ttf");
+  CheckResolves("Hack Nerd Font", false, false, "HackNerdFont-Regular.ttf");
+
+  // substitutes are rejected
+  Check(
+    GetFontPathFromName({.name = "No Such Font Neogurt"}).empty(),
+    "unknown font resolves to nothing"
+  );
+
+  // found fonts are persisted in the index
+  Check(fs::exists(tmpDir / "font_index"), "font_index written");
+
+  fs::remove_all(tmpDir);
+  if (failures == 0) std::cout << "font locator: all checks passed\n";
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,180 @@
+// times box::Pen rasterizing the box drawing and braille ranges at 1x, 2x and 3x
+// dpi, and generating the quads of a full screen of braille as circle shapes per
+// dot and as atlas glyphs.
+// not run by ctest, build the pen_bench target and run it directly
+#include "gfx/box_chars.hpp"
+#include "gfx/pen.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std::chrono;
+
+// cell of a typical 14pt monospace font, fractional like most fonts
+static constexpr float cellWidth = 8.43;
+static constexpr float cellHeight = 17;
+static constexpr int iterations = 500;
+static constexpr int runs = 7;
+
+// time to draw charcodes [begin, end) once, best of runs averaged over
+// iterations. same canvas setup as BoxDrawing
+static double TimeRange(char32_t begin, char32_t end, float dpiScale) {
+  int width = std::ceil(cellWidth * dpiScale);
+  int height = cellHeight * dpiScale;
+  std::vector<uint8_t> canvasRaw(width * height);
+  box::BufType canvas(canvasRaw.data(), height, width);
+  box::Pen pen;
+
+  std::vector<box::DrawDesc> descs;
+  for (char32_t charcode = begin; charcode < end; charcode++) {
+    if (auto desc = box::GetDrawDesc(charcode)) descs.push_back(*desc);
+  }
+
+  double best = INFINITY;
+  for (int run = 0; run < runs; run++) {
+    auto start = steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      for (const auto& desc : descs) {
+        std::ranges::fill(canvasRaw, 0);
+        pen.SetCanvas(canvas, dpiScale);
+        pen.Draw(desc);
+      }
+    }
+    duration<double, std::micro> elapsed = steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / iterations);
+  }
+  return best;
+}
+
+// vertex layouts of gfx/pipeline.hpp, without the glm and webgpu dependencies
+struct ShapeQuadVertex {
+  float position[2];
+  float size[2];
+  float coord[2];
+  float color[4];
+  uint32_t shapeType;
+  uint32_t shapeDesc;
+};
+
+struct TextQuadVertex {
+  float position[2];
+  float regionCoord[2];
+  float foreground[4];
+};
+
+static constexpr int screenIterations = 50;
+
+// quads emitted per braille cell before braille was drawn into the atlas, one
+// circle shape per raised dot. same dot layout as box::Pen
+static void AddBrailleDots(
+  const std::vector<uint8_t>& cells, int cols, std::vector<ShapeQuadVertex>& vertices
+) {
+  static constexpr float dotX[8] = {1, 1, 1, 3, 3, 3, 1, 3};
+  static constexpr float dotY[8] = {1, 3, 5, 1, 3, 5, 7, 7};
+  float radius = std::min(cellWidth / 2, cellHeight / 4) / 2 * 0.6f;
+  for (size_t i = 0; i < cells.size(); i++) {
+    float cellX = (i % cols) * cellWidth;
+    float cellY = (i / cols) * cellHeight;
+    for (int dot = 0; dot < 8; dot++) {
+      if (!(cells[i] & (1 << dot))) continue;
+      float x = cellX + dotX[dot] / 4 * cellWidth - radius;
+      float y = cellY + dotY[dot] / 8 * cellHeight - radius;
+      for (int corner = 0; corner < 4; corner++) {
+        float dx = (corner == 1 || corner == 2) ? radius * 2 : 0;
+        float dy = corner >= 2 ? radius * 2 : 0;
+        vertices.push_back({
+          .position = {x + dx, y + dy},
+          .size = {radius * 2, radius * 2},
+          .coord = {dx, dy},
+          .color = {1, 1, 1, 1},
+          .shapeType = 5,
+          .shapeDesc = 0,
+        });
+      }
+    }
+  }
+}
+
+// one text quad per cell, the pattern's region in the atlas is looked up
+static void AddBrailleGlyphs(
+  const std::vector<uint8_t>& cells, int cols, std::vector<TextQuadVertex>& vertices
+) {
+  // atlas regions of the 256 prerendered patterns, 16 per atlas row
+  float regionX[256];
+  float regionY[256];
+  for (int dots = 0; dots < 256; dots++) {
+    regionX[dots] = (dots % 16) * std::ceil(cellWidth);
+    regionY[dots] = (dots / 16) * cellHeight;
+  }
+  for (size_t i = 0; i < cells.size(); i++) {
+    float x = (i % cols) * cellWidth;
+    float y = (i / cols) * cellHeight;
+    float u = regionX[cells[i]];
+    float v = regionY[cells[i]];
+    for (int corner = 0; corner < 4; corner++) {
+      float dx = (corner == 1 || corner == 2) ? cellWidth : 0;
+      float dy = corner >= 2 ? cellHeight : 0;
+      vertices.push_back({
+        .position = {x + dx, y + dy},
+        .regionCoord = {u + dx, v + dy},
+        .foreground = {1, 1, 1, 1},
+      });
+    }
+  }
+}
+
+int main() {
+  std::cout << std::fixed << std::setprecision(1);
+  for (float dpiScale : {1.0f, 2.0f, 3.0f}) {
+    double boxTime = TimeRange(box::boxCharsBegin, box::boxCharsEnd, dpiScale);
+    double brailleTime = TimeRange(box::brailleBegin, box::brailleEnd, dpiScale);
+    std::cout << dpiScale << "x: box drawing U+2500-U+259F " << boxTime
+              << " us, braille U+2800-U+28FF " << brailleTime << " us\n";
+  }
+
+  // full screen of random braille, as drawn by plotting plugins. braille used to
+  // be one circle shape quad per dot, it's now one text quad per cell from the
+  // atlas, plus rasterizing the 256 patterns once per size
+  constexpr int cols = 240;
+  constexpr int rows = 67;
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> dotsDist(0, 255);
+  std::vector<uint8_t> cells(cols * rows);
+  for (auto& cell : cells) cell = dotsDist(rng);
+
+  double dotsTime = INFINITY;
+  double atlasTime = INFINITY;
+  std::vector<ShapeQuadVertex> shapeVertices;
+  std::vector<TextQuadVertex> textVertices;
+  for (int run = 0; run < runs; run++) {
+    auto start = steady_clock::now();
+    for (int i = 0; i < screenIterations; i++) {
+      shapeVertices.clear();
+      AddBrailleDots(cells, cols, shapeVertices);
+    }
+    duration<double, std::micro> elapsed = steady_clock::now() - start;
+    dotsTime = std::min(dotsTime, elapsed.count() / screenIterations);
+
+    start = steady_clock::now();
+    for (int i = 0; i < screenIterations; i++) {
+      textVertices.clear();
+      AddBrailleGlyphs(cells, cols, textVertices);
+    }
+    elapsed = steady_clock::now() - start;
+    atlasTime = std::min(atlasTime, elapsed.count() / screenIterations);
+  }
+  size_t dotQuads = shapeVertices.size() / 4;
+  size_t atlasQuads = textVertices.size() / 4;
+
+  std::cout << cols << "x" << rows << " braille screen, quad generation per frame:\n"
+            << "  circle per dot: " << dotQuads << " quads, "
+            << dotQuads * 4 * sizeof(ShapeQuadVertex) / 1024 << " KB, " << dotsTime
+            << " us\n"
+            << "  atlas glyph:    " << atlasQuads << " quads, "
+            << atlasQuads * 4 * sizeof(TextQuadVertex) / 1024 << " KB, " << atlasTime
+            << " us\n";
+}
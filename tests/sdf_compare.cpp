@@ -0,0 +1,179 @@
+// compares sdf glyphs scaled to a size with bitmap glyphs rasterized at that size,
+// and times what a size change costs in each mode.
+// sdf glyphs are reconstructed like text_sdf.wgsl: bilinear distance, smoothstep
+// over the screen space derivative. not run by ctest, build the sdf_compare
+// target and run it directly, optionally with a font path.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+using namespace std::chrono;
+
+// same as FontFamily::sdfHeight and the Font load flags
+static constexpr int sdfHeight = 48;
+static constexpr FT_Int32 loadFlags = FT_LOAD_DEFAULT;
+
+struct Glyph {
+  int left;
+  int top;
+  int width;
+  int rows;
+  std::vector<uint8_t> data;
+
+  float At(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width || y >= rows) return 0;
+    return data[y * width + x] / 255.0f;
+  }
+};
+
+static Glyph Render(FT_Face face, char32_t charcode, FT_Render_Mode mode) {
+  FT_Load_Char(face, charcode, loadFlags);
+  FT_Render_Glyph(face->glyph, mode);
+  const FT_Bitmap& bitmap = face->glyph->bitmap;
+  Glyph glyph{
+    .left = face->glyph->bitmap_left,
+    .top = face->glyph->bitmap_top,
+    .width = int(bitmap.width),
+    .rows = int(bitmap.rows),
+    .data = {},
+  };
+  for (int y = 0; y < glyph.rows; y++) {
+    const uint8_t* src = bitmap.buffer + ptrdiff_t(y) * bitmap.pitch;
+    glyph.data.insert(glyph.data.end(), src, src + glyph.width);
+  }
+  return glyph;
+}
+
+static float SampleDistance(const Glyph& sdf, float x, float y) {
+  float fx = x - 0.5f;
+  float fy = y - 0.5f;
+  int x0 = std::floor(fx);
+  int y0 = std::floor(fy);
+  float tx = fx - x0;
+  float ty = fy - y0;
+  auto lerp = [](float a, float b, float t) { return a + (b - a) * t; };
+  return lerp(
+    lerp(sdf.At(x0, y0), sdf.At(x0 + 1, y0), tx),
+    lerp(sdf.At(x0, y0 + 1), sdf.At(x0 + 1, y0 + 1), tx), ty
+  );
+}
+
+static float Smoothstep(float edge0, float edge1, float x) {
+  float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+  return t * t * (3 - 2 * t);
+}
+
+// coverage differences of pixels covered in either glyph
+struct Error {
+  std::vector<float> diffs;
+
+  double Mean() const {
+    double sum = 0;
+    for (float diff : diffs) sum += diff;
+    return sum / diffs.size();
+  }
+  double Percentile(double p) {
+    auto nth = diffs.begin() + size_t(p * (diffs.size() - 1));
+    std::ranges::nth_element(diffs, nth);
+    return *nth;
+  }
+};
+
+// coverage error of sdf scaled to the bitmap, over the bitmap box plus a border
+static void Compare(const Glyph& bitmap, const Glyph& sdf, float scale, Error& error) {
+  constexpr int border = 2;
+  int width = bitmap.width + border * 2;
+  int rows = bitmap.rows + border * 2;
+  std::vector<float> dist(width * rows);
+  for (int y = 0; y < rows; y++) {
+    for (int x = 0; x < width; x++) {
+      // pixel center relative to the glyph origin, y down
+      float px = bitmap.left - border + x + 0.5f;
+      float py = -bitmap.top - border + y + 0.5f;
+      dist[y * width + x] =
+        SampleDistance(sdf, px * scale - sdf.left, py * scale + sdf.top);
+    }
+  }
+
+  for (int y = 0; y < rows; y++) {
+    for (int x = 0; x < width; x++) {
+      // fwidth, finite differences like a 2x2 fragment quad
+      float d = dist[y * width + x];
+      int nx = x + 1 < width ? x + 1 : x - 1;
+      int ny = y + 1 < rows ? y + 1 : y - 1;
+      float fw =
+        std::abs(dist[y * width + nx] - d) + std::abs(dist[ny * width + x] - d);
+      float fade = std::max(fw * 0.5f, 1e-4f);
+      float alpha = Smoothstep(0.5f - fade, 0.5f + fade, d);
+
+      float expected = bitmap.At(x - border, y - border);
+      if (alpha == 0 && expected == 0) continue;
+      error.diffs.push_back(std::abs(alpha - expected));
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  std::string fontPath =
+    argc > 1 ? argv[1] : ROOT_DIR "/res/Hack/HackNerdFontMono-Regular.ttf";
+
+  FT_Library library;
+  FT_Init_FreeType(&library);
+  FT_Face face;
+  if (FT_New_Face(library, fontPath.c_str(), 0, &face) != 0) {
+    std::cerr << "failed to open " << fontPath << "\n";
+    return 1;
+  }
+
+  std::vector<char32_t> charcodes;
+  for (char32_t charcode = '!'; charcode <= '~'; charcode++) {
+    charcodes.push_back(charcode);
+  }
+
+  // one time cost of the sdf atlas
+  auto start = steady_clock::now();
+  FT_Set_Pixel_Sizes(face, 0, sdfHeight);
+  std::vector<Glyph> sdfGlyphs;
+  for (char32_t charcode : charcodes) {
+    sdfGlyphs.push_back(Render(face, charcode, FT_RENDER_MODE_SDF));
+  }
+  duration<double, std::milli> sdfTime = steady_clock::now() - start;
+
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "sdf atlas: " << charcodes.size() << " glyphs at " << sdfHeight
+            << "px in " << sdfTime.count() << " ms, done once\n\n";
+  std::cout << "size  bitmap size change  sdf size change  mean error  p99 error\n";
+
+  for (int size : {10, 12, 14, 16, 18, 20, 24, 28, 32}) {
+    // bitmap mode re-rasterizes on a size change, sdf mode only needs metrics
+    start = steady_clock::now();
+    FT_Set_Pixel_Sizes(face, 0, size);
+    duration<double, std::milli> sdfChange = steady_clock::now() - start;
+    std::vector<Glyph> bitmaps;
+    for (char32_t charcode : charcodes) {
+      bitmaps.push_back(Render(face, charcode, FT_RENDER_MODE_NORMAL));
+    }
+    duration<double, std::milli> bitmapChange = steady_clock::now() - start;
+
+    Error error;
+    float scale = float(sdfHeight) / size;
+    for (size_t i = 0; i < charcodes.size(); i++) {
+      Compare(bitmaps[i], sdfGlyphs[i], scale, error);
+    }
+
+    std::cout << std::setw(4) << size << "  " << std::setw(15)
+              << bitmapChange.count() << " ms  " << std::setw(12) << sdfChange.count()
+              << " ms  " << std::setw(10) << error.Mean() << "  " << std::setw(9)
+              << error.Percentile(0.99) << "\n";
+  }
+
+  FT_Done_Face(face);
+  FT_Done_FreeType(library);
+}